@@ -41,12 +41,11 @@
 #include "Cinder-LeapSdk.h"
 
 /* 
- * The Cinder-LeapSdk block does not wrap Leap's
- * Gesture API.  Instead, it delivers native Leap
- * Gestures in each LeapSdk::Frame. The properties 
- * of each Leap::Gesture may be converted to Cinder-
- * friendly types by using the LeapSdk::fromLeap*
- * methods, as demonstrated here.
+ * The Cinder-LeapSdk block delivers native Leap
+ * Gestures in each LeapSdk::Frame. A LeapSdk::
+ * GestureRouter decodes them once into plain
+ * LeapSdk::GestureData and calls a handler per
+ * gesture type, as demonstrated here.
  */
 class GestureApp : public ci::app::AppBasic
 {
@@ -63,6 +62,13 @@ private:
 	LeapSdk::Frame			mFrame;
 	LeapSdk::DeviceRef		mLeap;
 	void 					onFrame( LeapSdk::Frame frame );
+	
+	// Gestures
+	LeapSdk::GestureRouter	mGestureRouter;
+	void					onCircle( const LeapSdk::GestureData& gesture );
+	void					onKeyTap( const LeapSdk::GestureData& gesture );
+	void					onScreenTap( const LeapSdk::GestureData& gesture );
+	void					onSwipe( const LeapSdk::GestureData& gesture );
 	ci::Vec2f				warpPointable( const LeapSdk::Pointable& p );
 	ci::Vec2f				warpVector( const ci::Vec3f& v );
 	
@@ -102,7 +108,19 @@ private:
 		float				mBrightness;
 	};
 	std::vector<Key>		mKeys;
+	LeapSdk::HitGrid		mKeyGrid;
 
+	// Dots are collected through the frame and drawn
+	// as textured quads in one call by drawDots()
+	std::vector<ci::Vec2f>	mDotPositions;
+	std::vector<float>		mDotRadii;
+	ci::gl::Texture			mDotTexture;
+	std::vector<ci::Vec2f>	mDotTexCoords;
+	std::vector<ci::Vec2f>	mDotVertices;
+	std::map<int32_t, std::vector<ci::Vec2f> >	mUnitCircles;
+	void					addDot( const ci::Vec2f& position, float radius );
+	void					drawDots();
+	
 	// Rendering
 	void					drawDottedCircle( const ci::Vec2f& center, float radius,
 											 float dotRadius, int32_t resolution,
@@ -122,6 +140,7 @@ private:
 };
 
 #include "cinder/ImageIo.h"
+#include "cinder/Surface.h"
 #include "cinder/Utilities.h"
 
 // Imports
@@ -130,6 +149,13 @@ using namespace ci::app;
 using namespace LeapSdk;
 using namespace std;
 
+// Queues a dot to be drawn with the rest of the frame's dots
+void GestureApp::addDot( const Vec2f& position, float radius )
+{
+	mDotPositions.push_back( position );
+	mDotRadii.push_back( radius );
+}
+
 // Render
 void GestureApp::draw()
 {
@@ -147,6 +173,7 @@ void GestureApp::draw()
 	drawUi();
 	drawGestures();
 	drawPointables();
+	drawDots();
 	
 	gl::popMatrices();
 	
@@ -154,20 +181,85 @@ void GestureApp::draw()
 	mParams.draw();
 }
 
+// Draws all queued dots in one call
+void GestureApp::drawDots()
+{
+	size_t count = mDotPositions.size();
+	if ( count == 0 ) {
+		return;
+	}
+	
+	// Texture coordinates are the same for every quad
+	if ( mDotTexCoords.size() < count * 4 ) {
+		size_t offset = mDotTexCoords.size();
+		mDotTexCoords.resize( count * 4 );
+		for ( size_t i = offset; i < mDotTexCoords.size(); i += 4 ) {
+			mDotTexCoords[ i + 0 ] = Vec2f( 0.0f, 0.0f );
+			mDotTexCoords[ i + 1 ] = Vec2f( 1.0f, 0.0f );
+			mDotTexCoords[ i + 2 ] = Vec2f( 1.0f, 1.0f );
+			mDotTexCoords[ i + 3 ] = Vec2f( 0.0f, 1.0f );
+		}
+	}
+	
+	// Expand each dot into a quad
+	mDotVertices.resize( count * 4 );
+	const Vec2f* positions	= &mDotPositions[ 0 ];
+	const float* radii		= &mDotRadii[ 0 ];
+	Vec2f* vertices			= &mDotVertices[ 0 ];
+	for ( size_t i = 0; i < count; ++i ) {
+		float x		= positions[ i ].x;
+		float y		= positions[ i ].y;
+		float r		= radii[ i ];
+		vertices[ i * 4 + 0 ] = Vec2f( x - r, y - r );
+		vertices[ i * 4 + 1 ] = Vec2f( x + r, y - r );
+		vertices[ i * 4 + 2 ] = Vec2f( x + r, y + r );
+		vertices[ i * 4 + 3 ] = Vec2f( x - r, y + r );
+	}
+	
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	glVertexPointer( 2, GL_FLOAT, 0, &mDotVertices[ 0 ] );
+	glTexCoordPointer( 2, GL_FLOAT, 0, &mDotTexCoords[ 0 ] );
+	mDotTexture.enableAndBind();
+	glDrawArrays( GL_QUADS, 0, (GLsizei)( count * 4 ) );
+	mDotTexture.unbind();
+	mDotTexture.disable();
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+	
+	mDotPositions.clear();
+	mDotRadii.clear();
+}
+
 // Draw dotted circle
 void GestureApp::drawDottedCircle( const Vec2f& center, float radius, float dotRadius,
 								  int32_t resolution, float progress )
 {
-	float twoPi		= (float)M_PI * 2.0f;
-	progress		*= twoPi;
-	float delta		= twoPi / (float)resolution;
-	for ( float theta = 0.0f; theta <= progress; theta += delta ) {
-		float t		= theta - (float)M_PI * 0.5f;
-		float x		= math<float>::cos( t );
-		float y		= math<float>::sin( t );
-		
-		Vec2f pos	= center + Vec2f( x, y ) * radius;
-		gl::drawSolidCircle( pos, dotRadius, 32 );
+	if ( resolution <= 0 ) {
+		return;
+	}
+	
+	// Dot offsets are computed once per resolution, starting at 
+	// the top and going clockwise
+	vector<Vec2f>& circle = mUnitCircles[ resolution ];
+	if ( circle.empty() ) {
+		float delta = ( (float)M_PI * 2.0f ) / (float)resolution;
+		for ( int32_t i = 0; i < resolution; ++i ) {
+			float t = (float)i * delta - (float)M_PI * 0.5f;
+			circle.push_back( Vec2f( math<float>::cos( t ), math<float>::sin( t ) ) );
+		}
+	}
+	
+	// Anything past one full turn would land on existing dots
+	int32_t count	= (int32_t)( math<float>::max( progress, 0.0f ) * (float)resolution ) + 1;
+	count			= math<int32_t>::min( count, resolution );
+	
+	size_t offset	= mDotPositions.size();
+	mDotPositions.resize( offset + count );
+	mDotRadii.resize( offset + count, dotRadius );
+	Vec2f* positions = &mDotPositions[ offset ];
+	for ( int32_t i = 0; i < count; ++i ) {
+		positions[ i ] = center + circle[ i ] * radius;
 	}
 }
 
@@ -175,22 +267,28 @@ void GestureApp::drawDottedCircle( const Vec2f& center, float radius, float dotR
 void GestureApp::drawDottedRect( const Vec2f& center, const Vec2f &size )
 {
 	Rectf rect( center - size, center + size );
-	Vec2f pos = rect.getUpperLeft();
-	while ( pos.x < rect.getX2() ) {
-		gl::drawSolidCircle( pos, mDotRadius, mCircleResolution );
-		pos.x += mDotSpacing;
-	}
-	while ( pos.y < rect.getY2() ) {
-		gl::drawSolidCircle( pos, mDotRadius, mCircleResolution );
-		pos.y += mDotSpacing;
-	}
-	while ( pos.x > rect.getX1() ) {
-		gl::drawSolidCircle( pos, mDotRadius, mCircleResolution );
-		pos.x -= mDotSpacing;
+	
+	// Walk clockwise from the upper left corner. Sides are 
+	// rounded up to whole steps, so the right and bottom 
+	// edges may land slightly outside the rectangle.
+	int32_t columns	= (int32_t)math<float>::ceil( rect.getWidth() / mDotSpacing );
+	int32_t rows	= (int32_t)math<float>::ceil( rect.getHeight() / mDotSpacing );
+	float right		= rect.x1 + (float)columns * mDotSpacing;
+	float bottom	= rect.y1 + (float)rows * mDotSpacing;
+	
+	size_t offset	= mDotPositions.size();
+	mDotPositions.resize( offset + ( columns + rows ) * 2 );
+	mDotRadii.resize( mDotPositions.size(), mDotRadius );
+	Vec2f* positions = &mDotPositions[ offset ];
+	for ( int32_t i = 0; i < columns; ++i ) {
+		float x = (float)i * mDotSpacing;
+		positions[ i ]						= Vec2f( rect.x1 + x, rect.y1 );
+		positions[ columns + rows + i ]		= Vec2f( right - x, bottom );
 	}
-	while ( pos.y > rect.getY1() ) {
-		gl::drawSolidCircle( pos, mDotRadius, mCircleResolution );
-		pos.y -= mDotSpacing;
+	for ( int32_t i = 0; i < rows; ++i ) {
+		float y = (float)i * mDotSpacing;
+		positions[ columns + i ]			= Vec2f( right, rect.y1 + y );
+		positions[ columns * 2 + rows + i ]	= Vec2f( rect.x1, bottom - y );
 	}
 }
 
@@ -200,25 +298,21 @@ void GestureApp::drawGestures()
 	gl::color( ColorAf::white() );
 	
 	// Iterate through gestures
-	const vector<Leap::Gesture>& gestures = mFrame.getGestures();
-	for ( vector<Leap::Gesture>::const_iterator iter = gestures.begin(); iter != gestures.end(); ++iter ) {
-		Gesture::Type type = iter->type();
+	const GestureList& gestures = mFrame.getGestures();
+	for ( GestureList::const_iterator iter = gestures.begin(); iter != gestures.end(); ++iter ) {
+		const GestureData& gesture = *iter;
+		Gesture::Type type = gesture.mType;
 		if ( type == Gesture::Type::TYPE_CIRCLE ) {
 			
-			// Cast to circle gesture and read data
-			const Leap::CircleGesture& gesture = (Leap::CircleGesture)*iter;
-						
-			Vec2f pos	= warpVector( fromLeapVector( gesture.center() ) );
-			float progress	= gesture.progress();
-			float radius	= gesture.radius() * 2.0f; // Don't ask, it works
+			Vec2f pos		= warpVector( gesture.mPosition );
+			float progress	= gesture.mProgress;
+			float radius	= gesture.mRadius * 2.0f; // Don't ask, it works
 			
 			drawDottedCircle( pos, radius, mDotRadius, mCircleResolution, progress );
 			
 		} else if ( type == Gesture::Type::TYPE_KEY_TAP ) {
 			
-			// Cast to circle gesture and read data
-			const Leap::KeyTapGesture& gesture = (Leap::KeyTapGesture)*iter;
-			Vec2f center = warpVector( fromLeapVector( gesture.position() ) );
+			Vec2f center = warpVector( gesture.mPosition );
 			
 			// Draw square where key press happened
 			Vec2f size( 30.0f, 30.0f );
@@ -232,10 +326,8 @@ void GestureApp::drawGestures()
 			drawDottedRect( center, size );
 		} else if ( type == Gesture::Type::TYPE_SWIPE ) {
 			
-			// Cast to swipe gesture and read data
-			const Leap::SwipeGesture& gesture = (Leap::SwipeGesture)*iter;
-			ci::Vec2f a	= warpVector( fromLeapVector( gesture.startPosition() ) );
-			ci::Vec2f b	= warpVector( fromLeapVector( gesture.position() ) );
+			ci::Vec2f a	= warpVector( gesture.mStartPosition );
+			ci::Vec2f b	= warpVector( gesture.mPosition );
 			
 			// Set draw direction
 			float spacing = mDotRadius * 3.0f;
@@ -246,13 +338,13 @@ void GestureApp::drawGestures()
 			}
 			
 			// Draw swipe line
-			Vec2f pos = a;
-			while ( pos.x <= b.x ) {
-				pos.x += spacing;
-				gl::drawSolidCircle( pos, mDotRadius, 32 );
+			int32_t count = (int32_t)( ( b.x - a.x ) / spacing ) + 1;
+			for ( int32_t i = 1; i <= count; ++i ) {
+				addDot( Vec2f( a.x + (float)i * spacing, a.y ), mDotRadius );
 			}
 			
 			// Draw arrow head
+			Vec2f pos;
 			if ( direction > 0.0f ) {
 				pos		= b;
 				spacing	*= -1.0f;
@@ -262,11 +354,11 @@ void GestureApp::drawGestures()
 			}
 			pos.y		= a.y;
 			pos.x		+= spacing;
-			gl::drawSolidCircle( pos + Vec2f( 0.0f, spacing ), mDotRadius, 32 );
-			gl::drawSolidCircle( pos + Vec2f( 0.0f, spacing * -1.0f ), mDotRadius, 32 );
+			addDot( pos + Vec2f( 0.0f, spacing ), mDotRadius );
+			addDot( pos + Vec2f( 0.0f, spacing * -1.0f ), mDotRadius );
 			pos.x		+= spacing;
-			gl::drawSolidCircle( pos + Vec2f( 0.0f, spacing * 2.0f ), mDotRadius, 32 );
-			gl::drawSolidCircle( pos + Vec2f( 0.0f, spacing * -2.0f ), mDotRadius, 32 );
+			addDot( pos + Vec2f( 0.0f, spacing * 2.0f ), mDotRadius );
+			addDot( pos + Vec2f( 0.0f, spacing * -2.0f ), mDotRadius );
 		}
 	}
 }
@@ -316,12 +408,53 @@ void GestureApp::drawUi()
 	}
 }
 
+// Circle gesture controls the dial
+void GestureApp::onCircle( const GestureData& gesture )
+{
+	mDialBrightness	= 1.0f;
+	mDialValueDest	= gesture.mProgress;
+}
+
 // Called when Leap frame data is ready
 void GestureApp::onFrame( Frame frame )
 {
 	mFrame = frame;
 }
 
+// Key tap presses the key under it
+void GestureApp::onKeyTap( const GestureData& gesture )
+{
+	Vec2f center	= warpVector( gesture.mPosition );
+	center			-= mOffset;
+	
+	int32_t id = mKeyGrid.hitTest( center );
+	if ( id >= 0 ) {
+		mKeys[ id ].mBrightness = 1.0f;
+	}
+}
+
+// Turn background white for screen tap
+void GestureApp::onScreenTap( const GestureData& /*gesture*/ )
+{
+	mBackgroundBrightness = 1.0f;
+}
+
+// Swipe moves the swipe bar
+void GestureApp::onSwipe( const GestureData& gesture )
+{
+	Vec2f a	= warpVector( gesture.mStartPosition );
+	Vec2f b	= warpVector( gesture.mPosition );
+	
+	mSwipeBrightness	= 1.0f;
+	if ( gesture.mState == Gesture::State::STATE_STOP ) {
+		mSwipePosDest	= b.x < a.x ? 0.0f : 1.0f;
+	} else {
+		float step		= mSwipeStep;
+		mSwipePosDest	+= b.x < a.x ? -step : step;
+	}
+	mSwipePosDest		= math<float>::clamp( mSwipePosDest, 0.0f, 1.0f );
+}
+
 // Prepare window
 void GestureApp::prepareSettings( Settings *settings )
 {
@@ -380,19 +513,39 @@ void GestureApp::setup()
 	// Sets master offset
 	resize();
 	
+	// Create antialiased dot texture. Mipmapping keeps 
+	// edges smooth when dots are a few pixels wide.
+	Surface8u dot( 64, 64, true );
+	Surface8u::Iter iter = dot.getIter();
+	while ( iter.line() ) {
+		while ( iter.pixel() ) {
+			Vec2f v			= Vec2f( iter.getPos() ) + Vec2f::one() * 0.5f - Vec2f::one() * 32.0f;
+			iter.r()		= 255;
+			iter.g()		= 255;
+			iter.b()		= 255;
+			iter.a()		= (uint8_t)( math<float>::clamp( 32.0f - v.length() ) * 255.0f );
+		}
+	}
+	gl::Texture::Format format;
+	format.enableMipmapping( true );
+	format.setMinFilter( GL_LINEAR_MIPMAP_LINEAR );
+	mDotTexture = gl::Texture( dot, format );
+	
 	// Lay out keys
 	float spacing = mKeySize + mKeySpacing;
 	for ( float y = mKeyRect.y1; y < mKeyRect.y2; y += spacing ) {
 		for ( float x = mKeyRect.x1; x < mKeyRect.x2; x += spacing ) {
 			Rectf bounds( x, y, x + mKeySize, y + mKeySize );
 			Key key( bounds );
+			mKeyGrid.set( (int32_t)mKeys.size(), bounds );
 			mKeys.push_back( key );
 		}
 	}
 	
 	// Start device
 	mLeap 		= Device::create();
-	mCallbackId = mLeap->addCallback( &GestureApp::onFrame, this );
+	mCallbackId = mLeap->addCallback( &GestureApp::onFrame, this, Device::CALLBACK_THREAD_UPDATE, 
+										Frame::FIELD_GESTURES | Frame::FIELD_TIPS );
 
 	// Enable all gesture types
 	mLeap->enableGesture( Gesture::Type::TYPE_CIRCLE );
@@ -400,6 +553,12 @@ void GestureApp::setup()
 	mLeap->enableGesture( Gesture::Type::TYPE_SCREEN_TAP );
 	mLeap->enableGesture( Gesture::Type::TYPE_SWIPE );
 	
+	// Route gestures to handlers
+	mGestureRouter.addHandler( Gesture::Type::TYPE_CIRCLE,		&GestureApp::onCircle,		this );
+	mGestureRouter.addHandler( Gesture::Type::TYPE_KEY_TAP,		&GestureApp::onKeyTap,		this );
+	mGestureRouter.addHandler( Gesture::Type::TYPE_SCREEN_TAP,	&GestureApp::onScreenTap,	this );
+	mGestureRouter.addHandler( Gesture::Type::TYPE_SWIPE,		&GestureApp::onSwipe,		this );
+	
 	// Params
 	mFrameRate	= 0.0f;
 	mFullScreen	= false;
@@ -428,60 +587,12 @@ void GestureApp::update()
 	}
 
 	// Update device
-	if ( mLeap && mLeap->isConnected() ) {		
+	if ( mLeap ) {
 		mLeap->update();
 	}
 	
-	const vector<Leap::Gesture>& gestures = mFrame.getGestures();
-	for ( vector<Leap::Gesture>::const_iterator iter = gestures.begin(); iter != gestures.end(); ++iter ) {
-		Gesture::Type type = iter->type();
-		if ( type == Gesture::Type::TYPE_CIRCLE ) {
-			
-			// Cast to circle gesture
-			const Leap::CircleGesture& gesture = (Leap::CircleGesture)*iter;
-			
-			// Control dial
-			mDialBrightness	= 1.0f;
-			mDialValueDest	= gesture.progress();
-			
-		} else if ( type == Gesture::Type::TYPE_KEY_TAP ) {
-			
-			// Cast to circle gesture and read data
-			const Leap::KeyTapGesture& gesture = (Leap::KeyTapGesture)*iter;
-			Vec2f center	= warpVector( fromLeapVector( gesture.position() ) );
-			center			-= mOffset;
-			
-			// Press key
-			for ( vector<Key>::iterator iter = mKeys.begin(); iter != mKeys.end(); ++iter ) {
-				if ( iter->mBounds.contains( center ) ) {
-					iter->mBrightness = 1.0f;
-					break;
-				}
-			}
-			
-		} else if ( type == Gesture::Type::TYPE_SCREEN_TAP ) {
-			
-			// Turn background white for screen tap
-			mBackgroundBrightness = 1.0f;
-			
-		} else if ( type == Gesture::Type::TYPE_SWIPE ) {
-			
-			// Cast to swipe gesture and read data
-			const Leap::SwipeGesture& gesture = (Leap::SwipeGesture)*iter;
-			ci::Vec2f a	= warpVector( fromLeapVector( gesture.startPosition() ) );
-			ci::Vec2f b	= warpVector( fromLeapVector( gesture.position() ) );
-			
-			// Update swipe position
-			mSwipeBrightness	= 1.0f;
-			if ( gesture.state() == Gesture::State::STATE_STOP ) {
-				mSwipePosDest	= b.x < a.x ? 0.0f : 1.0f;
-			} else {
-				float step		= mSwipeStep;
-				mSwipePosDest	+= b.x < a.x ? -step : step;
-			}
-			mSwipePosDest		= math<float>::clamp( mSwipePosDest, 0.0f, 1.0f );
-		}
-	}
+	// Handle new gestures
+	mGestureRouter.route( mFrame );
 	
 	// UI animation
 	mDialValue				= lerp( mDialValue, mDialValueDest, mDialSpeed );
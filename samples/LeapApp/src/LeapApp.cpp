@@ -53,18 +53,26 @@ private:
 	uint32_t				mCallbackId;
 	LeapSdk::HandMap		mHands;
 	LeapSdk::DeviceRef		mLeap;
+	std::string				mState;
+	uint32_t				mStateCallbackId;
 	void 					onFrame( LeapSdk::Frame frame );
+	void 					onState( LeapSdk::Device::State state );
 
 	// Camera
 	ci::CameraPersp			mCamera;
 
 	// Params
 	float					mFrameRate;
+	int32_t					mFramesDropped;
 	bool					mFullScreen;
+	float					mTrackingRate;
 	ci::params::InterfaceGl	mParams;
 
 	// Save screen shot
 	void					screenShot();
+
+	// Start or stop writing a Chrome trace of the frame pipeline
+	void					toggleTrace();
 };
 
 #include "cinder/ImageIo.h"
@@ -178,6 +186,36 @@ void LeapApp::onFrame( Frame frame )
 	mHands = frame.getHands();
 }
 
+// Called when the device connects, disconnects or stalls
+void LeapApp::onState( Device::State state )
+{
+	switch ( state ) {
+	case Device::STATE_CONNECTED:
+		mState = "Connected";
+		break;
+	case Device::STATE_STREAMING:
+		mState = "Streaming";
+		break;
+	case Device::STATE_STALLED:
+		mState = "Stalled";
+		break;
+	case Device::STATE_DISCONNECTED:
+		mState = "Disconnected";
+		break;
+	case Device::STATE_EXITED:
+		mState = "Exited";
+		break;
+	default:
+		mState = "Initializing";
+		break;
+	}
+
+	// Stop drawing hands from a frame that is no longer current
+	if ( state != Device::STATE_STREAMING ) {
+		mHands.clear();
+	}
+}
+
 // Prepare window
 void LeapApp::prepareSettings( Settings *settings )
 {
@@ -196,6 +234,21 @@ void LeapApp::screenShot()
 	writeImage( path / fs::path( "frame" + toString( getElapsedFrames() ) + ".png" ), copyWindowSurface() );
 }
 
+// Start or stop tracing
+void LeapApp::toggleTrace()
+{
+	if ( Tracer::isEnabled() ) {
+		Tracer::stop();
+	} else {
+#if defined( CINDER_MSW )
+		fs::path path = getAppPath();
+#else
+		fs::path path = getAppPath().parent_path();
+#endif
+		Tracer::start( ( path / fs::path( "trace" + toString( getElapsedFrames() ) + ".json" ) ).string() );
+	}
+}
+
 // Set up
 void LeapApp::setup()
 {
@@ -211,15 +264,23 @@ void LeapApp::setup()
 	
 	// Start device
 	mLeap 		= Device::create();
-	mCallbackId = mLeap->addCallback( &LeapApp::onFrame, this );
+	mCallbackId			= mLeap->addCallback( &LeapApp::onFrame, this );
+	mStateCallbackId	= mLeap->addStateCallback( &LeapApp::onState, this );
 
 	// Params
-	mFrameRate	= 0.0f;
-	mFullScreen	= false;
-	mParams = params::InterfaceGl( "Params", Vec2i( 200, 105 ) );
+	mFrameRate		= 0.0f;
+	mFramesDropped	= 0;
+	mFullScreen		= false;
+	mState			= "Initializing";
+	mTrackingRate	= 0.0f;
+	mParams = params::InterfaceGl( "Params", Vec2i( 200, 160 ) );
 	mParams.addParam( "Frame rate",		&mFrameRate,						"", true );
+	mParams.addParam( "Device",			&mState,							"", true );
+	mParams.addParam( "Tracking rate",	&mTrackingRate,						"", true );
+	mParams.addParam( "Frames dropped",	&mFramesDropped,					"", true );
 	mParams.addParam( "Full screen",	&mFullScreen,						"key=f"		);
 	mParams.addButton( "Screen shot",	bind( &LeapApp::screenShot, this ), "key=space" );
+	mParams.addButton( "Trace",			bind( &LeapApp::toggleTrace, this ), "key=t" );
 	mParams.addButton( "Quit",			bind( &LeapApp::quit, this ),		"key=q" );
 }
 
@@ -227,7 +288,9 @@ void LeapApp::setup()
 void LeapApp::shutdown()
 {
 	mLeap->removeCallback( mCallbackId );
+	mLeap->removeCallback( mStateCallbackId );
 	mHands.clear();
+	Tracer::stop();
 }
 
 // Runs update logic
@@ -242,8 +305,13 @@ void LeapApp::update()
 	}
 
 	// Update device
-	if ( mLeap && mLeap->isConnected() ) {		
+	if ( mLeap ) {
 		mLeap->update();
+
+		// Tells tracking problems apart from frames we were too slow to take
+		DeviceStats stats	= mLeap->getStats();
+		mFramesDropped		= (int32_t)stats.mFramesDropped;
+		mTrackingRate		= stats.mFrameRate;
 	}
 }
 
@@ -51,10 +51,8 @@ public:
 	void					update();
 private:
 	// Leap
-	uint32_t				mCallbackId;
 	LeapSdk::Frame			mFrame;
 	LeapSdk::DeviceRef		mLeap;
-	void 					onFrame( LeapSdk::Frame frame );
 
 	// Lighting
 	ci::gl::Light			*mLight;
@@ -91,6 +89,21 @@ static const float	kRestitution	= 0.021f;
 static const float	kRotSpeed		= 0.033f;
 static const float	kTranslateSpeed	= 0.0033f;
 
+// Mean distance from the palm to the tips of fingers also seen in 
+// the other hand, so fingers coming into view do not read as scaling
+static float getFingerSpread( const Hand& hand, const Hand& other )
+{
+	float spread	= 0.0f;
+	size_t count	= 0;
+	for ( FingerMap::const_iterator iter = hand.getFingers().begin(); iter != hand.getFingers().end(); ++iter ) {
+		if ( other.getFingers().find( iter->first ) != other.getFingers().end() ) {
+			spread += iter->second.getPosition().distance( hand.getPosition() );
+			++count;
+		}
+	}
+	return count > 0 ? spread / (float)count : 0.0f;
+}
+
 // Render
 void MotionApp::draw()
 {
@@ -121,21 +134,6 @@ void MotionApp::draw()
 	mParams.draw();
 }
 
-// Called when Leap frame data is ready
-void MotionApp::onFrame( Frame frame )
-{
-	HandMap hands = frame.getHands();
-	if ( !hands.empty() ) {
-		const Hand& hand	= hands.begin()->second;
-		
-		mRotAngle	+= hand.getRotationAngle( mFrame ) * kRotSpeed;
-		mRotAxis	+= hand.getRotationAxis( mFrame ) * -1.0f; // Mirror
-		mScale		*= hand.getScale( mFrame );
-		mTranslate	+= hand.getTranslation( mFrame ) * kTranslateSpeed;
-	}
-	mFrame = frame;
-}
-
 // Prepare window
 void MotionApp::prepareSettings( Settings *settings )
 {
@@ -179,7 +177,6 @@ void MotionApp::setup()
 	
 	// Start device
 	mLeap 		= Device::create();
-	mCallbackId = mLeap->addCallback( &MotionApp::onFrame, this );
 
 	// Params
 	mFrameRate	= 0.0f;
@@ -195,7 +192,7 @@ void MotionApp::setup()
 void MotionApp::shutdown()
 {
 	delete mLight;
-	mLeap->removeCallback( mCallbackId );
+	mFrame = Frame();
 }
 
 // Runs update logic
@@ -209,10 +206,38 @@ void MotionApp::update()
 		setFullScreen( mFullScreen );
 	}
 
-	// Update device
-	if ( mLeap && mLeap->isConnected() ) {		
+	// Update device. Sample the hand at render time so motion is 
+	// evenly paced, however frames line up with the display.
+	Frame frame;
+	if ( mLeap ) {
 		mLeap->update();
+		frame = mLeap->getInterpolatedFrame();
+	}
+
+	// Motion is measured from the previous sample
+	const HandMap& hands = frame.getHands();
+	if ( !hands.empty() ) {
+		const Hand& hand = hands.begin()->second;
+		HandMap::const_iterator iter = mFrame.getHands().find( hand.getId() );
+		if ( iter != mFrame.getHands().end() ) {
+			const Hand& previous = iter->second;
+
+			// Rotation turning the palm's axes from the previous sample
+			Vec3f rotation	= ( previous.getDirection().cross( hand.getDirection() ) + 
+								previous.getNormal().cross( hand.getNormal() ) ) * 0.5f;
+			float angle		= math<float>::asin( math<float>::min( rotation.length(), 1.0f ) );
+
+			mRotAngle	+= angle * kRotSpeed;
+			mRotAxis	+= rotation.safeNormalized() * -1.0f; // Mirror
+			// Spreading the fingers scales up, like the Leap scale factor
+			float spread = getFingerSpread( previous, hand );
+			if ( spread > 0.0f ) {
+				mScale	*= getFingerSpread( hand, previous ) / spread;
+			}
+			mTranslate	+= ( hand.getPosition() - previous.getPosition() ) * kTranslateSpeed;
+		}
 	}
+	mFrame = frame;
 	
 	mRotAngle	= lerp( mRotAngle, 0.0f, kRestitution );
 	mRotAxis	= mRotAxis.lerp( kRestitution, Vec3f::zero() );
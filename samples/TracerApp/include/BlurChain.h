@@ -0,0 +1,59 @@
+#pragma once
+
+#include "cinder/DataSource.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/GlslProg.h"
+#include "cinder/Vector.h"
+#include <string>
+#include <vector>
+
+// Separable Gaussian blur run over a pyramid of half float render
+// targets. The source is halved once per level and blurred at the
+// smallest level, so every level cuts the cost of the blur by four.
+class BlurChain
+{
+public:
+	BlurChain( size_t levels = 2, size_t taps = 5 );
+
+	// Compiles blur shader. The fragment shader receives the kernel
+	// length as KERNEL_SIZE.
+	void					setup( ci::DataSourceRef vertexShader, ci::DataSourceRef fragmentShader );
+	// Allocates render targets for a source of this size. Does
+	// nothing when the size has not changed.
+	void					resize( const ci::Vec2i& size );
+	// Blurs texture and returns the result at the smallest level's
+	// resolution. Draw it stretched to get the full size image.
+	ci::gl::Texture&		process( ci::gl::Texture& texture );
+
+	size_t					getLevels() const;
+	// Number of texture reads per pass
+	size_t					getTaps() const;
+	void					setLevels( size_t levels );
+	// Rounded up to an odd number
+	void					setTaps( size_t taps );
+
+	// Builds the kernel for a tap count. The first weight applies to
+	// the center sample. Each other weight applies to the pair of
+	// linearly filtered samples at plus and minus its offset, in texels.
+	static void				createKernel( size_t taps, std::vector<float>* offsets, std::vector<float>* weights );
+	// CPU reference for one blur pass. Samples with linear filtering
+	// and clamped edges like the shader. Axis 0 blurs horizontally,
+	// 1 vertically. Pixels are interleaved floats. tools/BlurCheck
+	// compares it against a direct Gaussian.
+	static void				blur( const float* source, float* destination, int32_t width, int32_t height,
+								int32_t channels, size_t taps, int32_t axis );
+private:
+	void					allocate();
+	void					compile();
+	void					pass( ci::gl::Texture& texture, ci::gl::Fbo& fbo, const ci::Vec2f& size );
+
+	std::string				mFragmentShader;
+	std::string				mVertexShader;
+	ci::gl::GlslProg		mShader;
+
+	size_t					mLevelCount;
+	std::vector<ci::gl::Fbo>	mLevels;
+	ci::gl::Fbo				mScratch;
+	ci::Vec2i				mSize;
+	size_t					mTaps;
+};
@@ -1,6 +1,5 @@
 #pragma once
 #include "cinder/CinderResources.h"
 
-#define RES_GLSL_BLUR_X_FRAG		CINDER_RESOURCE( ../resources/, blur_x_frag.glsl,		128, GLSL	)
-#define RES_GLSL_BLUR_Y_FRAG		CINDER_RESOURCE( ../resources/, blur_y_frag.glsl,		129, GLSL	)
+#define RES_GLSL_BLUR_FRAG			CINDER_RESOURCE( ../resources/, blur_frag.glsl,			128, GLSL	)
 #define RES_GLSL_PASS_THROUGH_VERT	CINDER_RESOURCE( ../resources/, pass_through_vert.glsl,	130, GLSL	)
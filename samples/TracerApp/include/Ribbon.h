@@ -1,25 +1,41 @@
 #pragma once
 
 #include "cinder/Color.h"
+#include "cinder/gl/Vbo.h"
 #include "cinder/Vector.h"
 #include <map>
 #include <vector>
 
 typedef std::map<int32_t, class Ribbon> RibbonMap;
 
+// Interleaved vertex used to draw ribbons in one batch
+struct RibbonVertex
+{
+	ci::Vec3f				mPosition;
+	ci::ColorAf				mColor;
+};
+
 class Ribbon
 {
 public:
-	Ribbon( int32_t id = 0, const ci::Colorf& color = ci::Colorf::white() );
-	~Ribbon();
+	// Holds up to "capacity" points, rounded up to a power of two. 
+	// The oldest point is dropped when a point is added to a full ribbon.
+	Ribbon( int32_t id = 0, const ci::Colorf& color = ci::Colorf::white(), size_t capacity = 256 );
 
 	void					addPoint( const ci::Vec3f& position, float width = 1.0f );
-	void					draw() const;
+	// Removes all points and reassigns ID and color, keeping storage
+	void					reset( int32_t id, const ci::Colorf& color );
 	void					update();
 
-	
 	const ci::Colorf&		getColor() const;
 	int32_t					getId() const;
+	size_t					getPointCount() const;
+	
+	// Number of vertices write() will output
+	size_t					getVertexCount() const;
+	// Writes ribbon as a triangle strip, with its first and last vertices
+	// repeated so strips can be joined. Returns end of written vertices.
+	RibbonVertex*			write( RibbonVertex* vertices ) const;
 private:
 	struct Point
 	{
@@ -31,6 +47,27 @@ private:
 
 	ci::Colorf				mColor;
 	int32_t					mId;
+	
+	// Points are stored in a circular buffer, oldest first
+	size_t					mCount;
+	size_t					mHead;
+	size_t					mMask;
 	std::vector<Point>		mPoints;
+
+	// Triangle strip vertices, allocated once at full capacity
+	std::vector<float>		mAlphas;
 	std::vector<ci::Vec3f>	mPositions;
+	size_t					mVertexCount;
+};
+
+// Draws all ribbons with one buffer upload and one draw call
+class RibbonBatch
+{
+public:
+	RibbonBatch();
+
+	void					draw( const RibbonMap& ribbons );
+private:
+	size_t					mCapacity;
+	ci::gl::Vbo				mVbo;
 };
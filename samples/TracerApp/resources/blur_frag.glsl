@@ -0,0 +1,17 @@
+// KERNEL_SIZE is defined by the application when the shader is compiled
+uniform vec2		size;
+uniform sampler2D	tex;
+uniform float		offsets[ KERNEL_SIZE ];
+uniform float		weights[ KERNEL_SIZE ];
+
+varying vec2		uv;
+
+void main( void )
+{
+	vec4 color		= texture2D( tex, uv ) * weights[ 0 ];
+	for ( int i = 1; i < KERNEL_SIZE; ++i ) {
+		vec2 offset	= size * offsets[ i ];
+		color		+= ( texture2D( tex, uv - offset ) + texture2D( tex, uv + offset ) ) * weights[ i ];
+	}
+	gl_FragColor	= color;
+}
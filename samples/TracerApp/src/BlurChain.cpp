@@ -0,0 +1,221 @@
+#include "BlurChain.h"
+
+#include "cinder/CinderMath.h"
+#include "cinder/gl/gl.h"
+#include "cinder/Utilities.h"
+
+using namespace ci;
+using namespace std;
+
+namespace
+{
+	// Reads a line of pixels at a fractional position the way
+	// GL_LINEAR with GL_CLAMP_TO_EDGE does
+	float sampleLinear( const float* line, int32_t stride, int32_t length, float position )
+	{
+		float x			= math<float>::floor( position );
+		float t			= position - x;
+		int32_t a		= math<int32_t>::clamp( (int32_t)x, 0, length - 1 );
+		int32_t b		= math<int32_t>::clamp( (int32_t)x + 1, 0, length - 1 );
+		return line[ a * stride ] + ( line[ b * stride ] - line[ a * stride ] ) * t;
+	}
+}
+
+BlurChain::BlurChain( size_t levels, size_t taps )
+	: mLevelCount( math<size_t>::clamp( levels, 1, 8 ) ), mSize( Vec2i::zero() ),
+	mTaps( math<size_t>::clamp( taps | 1, 1, 31 ) )
+{
+}
+
+void BlurChain::allocate()
+{
+	mLevels.clear();
+	mScratch = gl::Fbo();
+	if ( mSize.x <= 0 || mSize.y <= 0 ) {
+		return;
+	}
+
+	gl::Fbo::Format format;
+#if defined( CINDER_MSW )
+	format.setColorInternalFormat( GL_RGBA16F );
+#else
+	format.setColorInternalFormat( GL_RGBA16F_ARB );
+#endif
+	format.enableDepthBuffer( false );
+	format.setMinFilter( GL_LINEAR );
+	format.setMagFilter( GL_LINEAR );
+	format.setWrap( GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE );
+
+	Vec2i size = mSize;
+	for ( size_t i = 0; i < mLevelCount; ++i ) {
+		size.x = math<int32_t>::max( size.x / 2, 1 );
+		size.y = math<int32_t>::max( size.y / 2, 1 );
+		mLevels.push_back( gl::Fbo( size.x, size.y, format ) );
+	}
+	mScratch = gl::Fbo( size.x, size.y, format );
+}
+
+void BlurChain::blur( const float* source, float* destination, int32_t width, int32_t height,
+					 int32_t channels, size_t taps, int32_t axis )
+{
+	vector<float> offsets;
+	vector<float> weights;
+	createKernel( taps, &offsets, &weights );
+
+	int32_t length		= axis == 0 ? width : height;
+	int32_t lineCount	= axis == 0 ? height : width;
+	int32_t lineStride	= axis == 0 ? width * channels : channels;
+	int32_t stride		= axis == 0 ? channels : width * channels;
+	for ( int32_t line = 0; line < lineCount; ++line ) {
+		for ( int32_t c = 0; c < channels; ++c ) {
+			const float* src	= source + line * lineStride + c;
+			float* dst			= destination + line * lineStride + c;
+			for ( int32_t i = 0; i < length; ++i ) {
+				float value = src[ i * stride ] * weights[ 0 ];
+				for ( size_t j = 1; j < weights.size(); ++j ) {
+					float a	= sampleLinear( src, stride, length, (float)i - offsets[ j ] );
+					float b	= sampleLinear( src, stride, length, (float)i + offsets[ j ] );
+					value	+= ( a + b ) * weights[ j ];
+				}
+				dst[ i * stride ] = value;
+			}
+		}
+	}
+}
+
+void BlurChain::compile()
+{
+	vector<float> offsets;
+	vector<float> weights;
+	createKernel( mTaps, &offsets, &weights );
+
+	string fragmentShader = "#define KERNEL_SIZE " + toString( offsets.size() ) + "\n" + mFragmentShader;
+	mShader = gl::GlslProg( mVertexShader.c_str(), fragmentShader.c_str() );
+	mShader.bind();
+	mShader.uniform( "offsets",	&offsets[ 0 ], (int32_t)offsets.size() );
+	mShader.uniform( "tex",		0 );
+	mShader.uniform( "weights",	&weights[ 0 ], (int32_t)weights.size() );
+	mShader.unbind();
+}
+
+void BlurChain::createKernel( size_t taps, vector<float>* offsets, vector<float>* weights )
+{
+	size_t radius	= ( math<size_t>::max( taps, 1 ) - 1 ) / 2 * 2;
+	float sigma		= (float)( radius + 1 ) / 3.0f;
+
+	// Discrete Gaussian, normalized over both sides
+	vector<float> gaussian( radius + 1 );
+	float sum = 0.0f;
+	for ( size_t i = 0; i <= radius; ++i ) {
+		gaussian[ i ]	= math<float>::exp( -(float)( i * i ) / ( 2.0f * sigma * sigma ) );
+		sum				+= i == 0 ? gaussian[ i ] : gaussian[ i ] * 2.0f;
+	}
+	for ( size_t i = 0; i <= radius; ++i ) {
+		gaussian[ i ] /= sum;
+	}
+
+	// Fold neighbouring texels into one linearly filtered read
+	offsets->assign( 1, 0.0f );
+	weights->assign( 1, gaussian[ 0 ] );
+	for ( size_t i = 1; i < radius; i += 2 ) {
+		float weight = gaussian[ i ] + gaussian[ i + 1 ];
+		offsets->push_back( ( (float)i * gaussian[ i ] + (float)( i + 1 ) * gaussian[ i + 1 ] ) / weight );
+		weights->push_back( weight );
+	}
+}
+
+size_t BlurChain::getLevels() const
+{
+	return mLevelCount;
+}
+
+size_t BlurChain::getTaps() const
+{
+	return mTaps;
+}
+
+void BlurChain::pass( gl::Texture& texture, gl::Fbo& fbo, const Vec2f& size )
+{
+	fbo.bindFramebuffer();
+	gl::setViewport( fbo.getBounds() );
+	mShader.uniform( "size", size );
+	texture.bind();
+	gl::drawSolidRect( Rectf( fbo.getBounds() ) );
+	texture.unbind();
+	fbo.unbindFramebuffer();
+}
+
+gl::Texture& BlurChain::process( gl::Texture& texture )
+{
+	if ( mLevels.empty() || !mShader ) {
+		return texture;
+	}
+
+	glPushAttrib( GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT | GL_VIEWPORT_BIT );
+	gl::pushMatrices();
+	gl::disableAlphaBlending();
+	gl::color( ColorAf::white() );
+
+	// Halve the image once per level. Linear filtering
+	// averages each 2x2 block of the level above.
+	gl::Texture* source = &texture;
+	for ( vector<gl::Fbo>::iterator iter = mLevels.begin(); iter != mLevels.end(); ++iter ) {
+		iter->bindFramebuffer();
+		gl::setViewport( iter->getBounds() );
+		gl::setMatricesWindow( iter->getSize(), false );
+		source->enableAndBind();
+		gl::drawSolidRect( Rectf( iter->getBounds() ) );
+		source->unbind();
+		iter->unbindFramebuffer();
+		source = &iter->getTexture();
+	}
+
+	// Blur the smallest level horizontally into the
+	// scratch buffer, then vertically back again
+	gl::Fbo& level	= mLevels.back();
+	Vec2f texel		= Vec2f::one() / Vec2f( level.getSize() );
+	mShader.bind();
+	pass( level.getTexture(),		mScratch,	Vec2f( texel.x, 0.0f ) );
+	pass( mScratch.getTexture(),	level,		Vec2f( 0.0f, texel.y ) );
+	mShader.unbind();
+
+	gl::popMatrices();
+	glPopAttrib();
+
+	return level.getTexture();
+}
+
+void BlurChain::resize( const Vec2i& size )
+{
+	if ( size != mSize ) {
+		mSize = size;
+		allocate();
+	}
+}
+
+void BlurChain::setLevels( size_t levels )
+{
+	levels = math<size_t>::clamp( levels, 1, 8 );
+	if ( levels != mLevelCount ) {
+		mLevelCount = levels;
+		allocate();
+	}
+}
+
+void BlurChain::setTaps( size_t taps )
+{
+	taps = math<size_t>::clamp( taps | 1, 1, 31 );
+	if ( taps != mTaps ) {
+		mTaps = taps;
+		if ( mShader ) {
+			compile();
+		}
+	}
+}
+
+void BlurChain::setup( DataSourceRef vertexShader, DataSourceRef fragmentShader )
+{
+	mFragmentShader	= loadString( fragmentShader );
+	mVertexShader	= loadString( vertexShader );
+	compile();
+}
@@ -13,21 +13,32 @@ Ribbon::Point::Point( const Vec3f &position, float width )
 	mWidth		= width;
 }
 
-Ribbon::Ribbon( int32_t id, const Colorf& color )
+Ribbon::Ribbon( int32_t id, const Colorf& color, size_t capacity )
 {
-	mColor	= color;
-	mId		= id;
-}
+	size_t size = 2;
+	while ( size < capacity ) {
+		size <<= 1;
+	}
 
-Ribbon::~Ribbon()
-{
-	mPoints.clear();
+	mColor			= color;
+	mCount			= 0;
+	mHead			= 0;
+	mId				= id;
+	mMask			= size - 1;
+	mVertexCount	= 0;
+	mAlphas.resize( size * 2 );
+	mPoints.resize( size );
+	mPositions.resize( size * 2 );
 }
 
 void Ribbon::addPoint( const Vec3f& position, float width )
 {
-	Point point( position, width );
-	mPoints.push_back( point );
+	if ( mCount == mPoints.size() ) {
+		mHead = ( mHead + 1 ) & mMask;
+		--mCount;
+	}
+	mPoints[ ( mHead + mCount ) & mMask ] = Point( position, width );
+	++mCount;
 }
 
 const Colorf& Ribbon::getColor() const
@@ -40,66 +51,123 @@ int32_t Ribbon::getId() const
 	return mId;
 }
 
-void Ribbon::draw() const
+void Ribbon::reset( int32_t id, const Colorf& color )
 {
-	size_t count	= mPoints.size();
-	if ( count < 2 ) {
-		return;
-	}
+	mColor			= color;
+	mCount			= 0;
+	mHead			= 0;
+	mId				= id;
+	mVertexCount	= 0;
+}
+
+size_t Ribbon::getPointCount() const
+{
+	return mCount;
+}
 
-	glBegin( GL_TRIANGLES );
-	for ( size_t i = 0; i < count - 2; ++i ) {
-        uint32_t index = i * 2;
-
-		Vec3f pos0 = mPositions.at( index + 0 );
-		Vec3f pos1 = mPositions.at( index + 1 );
-		Vec3f pos2 = mPositions.at( index + 2 );
-		Vec3f pos3 = mPositions.at( index + 3 );
-
-		ColorAf color( mColor, mPoints.at( i ).mAlpha );
-		gl::color( color );
-
-		gl::vertex( pos0 );
-		gl::vertex( pos2 );
-		gl::vertex( pos1 );
-		gl::vertex( pos1 );
-		gl::vertex( pos2 );
-		gl::vertex( pos3 );
-    }
-	glEnd();
+size_t Ribbon::getVertexCount() const
+{
+	return mVertexCount < 4 ? 0 : mVertexCount + 2;
 }
 
 void Ribbon::update()
 {
-	for ( vector<Point>::iterator iter = mPoints.begin(); iter != mPoints.end(); ) {
-		iter->mAlpha		-= 0.01f;
-		iter->mWidth		-= 0.3f;
-		iter->mPosition.y	+= 1.0f;
-		if ( iter->mAlpha <= 0.0f || iter->mWidth <= 0.0f ) {
-			iter = mPoints.erase( iter );
-		} else {
-			++iter;
-		}
+	for ( size_t i = 0; i < mCount; ++i ) {
+		Point& point		= mPoints[ ( mHead + i ) & mMask ];
+		point.mAlpha		-= 0.01f;
+		point.mWidth		= math<float>::max( point.mWidth - 0.3f, 0.0f );
+		point.mPosition.y	+= 1.0f;
+	}
+
+	// Alpha fades at the same rate for every point, so points expire 
+	// from the head. A thin point that runs out of width before it 
+	// reaches the head collapses to zero width until it is removed.
+	while ( mCount > 0 && ( mPoints[ mHead ].mAlpha <= 0.0f || mPoints[ mHead ].mWidth <= 0.0f ) ) {
+		mHead = ( mHead + 1 ) & mMask;
+		--mCount;
+	}
+
+	// Offset each segment perpendicular to itself in the XY plane. Written 
+	// without branches or allocation so the compiler can vectorize it.
+	size_t segments	= mCount < 2 ? 0 : mCount - 1;
+	for ( size_t i = 0; i < segments; ++i ) {
+		const Point& a	= mPoints[ ( mHead + i ) & mMask ];
+		const Point& b	= mPoints[ ( mHead + i + 1 ) & mMask ];
+
+		float dx		= a.mPosition.x - b.mPosition.x;
+		float dy		= a.mPosition.y - b.mPosition.y;
+		float scale		= a.mWidth / math<float>::sqrt( math<float>::max( dx * dx + dy * dy, 0.000001f ) );
+		Vec3f offset( -dy * scale, dx * scale, 0.0f );
+
+		mAlphas[ i * 2 + 0 ]	= a.mAlpha;
+		mAlphas[ i * 2 + 1 ]	= a.mAlpha;
+		mPositions[ i * 2 + 0 ]	= a.mPosition - offset;
+		mPositions[ i * 2 + 1 ]	= b.mPosition + offset;
 	}
+	mVertexCount = segments * 2;
+}
+
+RibbonVertex* Ribbon::write( RibbonVertex* vertices ) const
+{
+	size_t count = mVertexCount;
+	if ( count < 4 ) {
+		return vertices;
+	}
+
+	RibbonVertex* v = vertices + 1;
+	for ( size_t i = 0; i < count; ++i, ++v ) {
+		v->mPosition	= mPositions[ i ];
+		v->mColor		= ColorAf( mColor, mAlphas[ i ] );
+	}
+	
+	// Repeat first and last vertices to join strips with degenerate triangles
+	*v			= *( v - 1 );
+	++v;
+	*vertices	= vertices[ 1 ];
+	return v;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
 
-	mPositions.clear();
-	size_t count = mPoints.size();
-	if ( count >= 2 ) {
-		for ( size_t i = 0; i < count - 1; ++i ) {
-			const Point& a	= mPoints.at( i );
-			const Point& b	= mPoints.at( i + 1 );
-
-			Vec3f pos0		= a.mPosition;
-			Vec3f pos1		= b.mPosition;
-			Vec3f dir		= pos0 - pos1;
-			dir.z			= 0.0f;
-			Vec3f tan		= dir.cross( Vec3f::zAxis() );
-			tan				= dir.cross( tan );
-			tan				= dir.cross( tan ).normalized();
-			Vec3f offset	= tan * a.mWidth;
-
-			mPositions.push_back( pos0 - offset );
-			mPositions.push_back( pos1 + offset );
+RibbonBatch::RibbonBatch()
+{
+	mCapacity = 0;
+}
+
+void RibbonBatch::draw( const RibbonMap& ribbons )
+{
+	size_t count = 0;
+	for ( RibbonMap::const_iterator iter = ribbons.begin(); iter != ribbons.end(); ++iter ) {
+		count += iter->second.getVertexCount();
+	}
+	if ( count == 0 ) {
+		return;
+	}
+	
+	if ( !mVbo || count > mCapacity ) {
+		mCapacity	= math<size_t>::max( count, mCapacity * 2 );
+		mVbo		= gl::Vbo( GL_ARRAY_BUFFER );
+	}
+	mVbo.bind();
+	
+	// Orphan last frame's storage so mapping does not wait on the GPU
+	mVbo.bufferData( mCapacity * sizeof( RibbonVertex ), 0, GL_STREAM_DRAW );
+	RibbonVertex* vertices = (RibbonVertex*)mVbo.map( GL_WRITE_ONLY );
+	if ( vertices != 0 ) {
+		RibbonVertex* v = vertices;
+		for ( RibbonMap::const_iterator iter = ribbons.begin(); iter != ribbons.end(); ++iter ) {
+			v = iter->second.write( v );
 		}
 	}
+	mVbo.unmap();
+	
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_COLOR_ARRAY );
+	glVertexPointer( 3, GL_FLOAT, sizeof( RibbonVertex ), (const GLvoid*)offsetof( RibbonVertex, mPosition ) );
+	glColorPointer( 4, GL_FLOAT, sizeof( RibbonVertex ), (const GLvoid*)offsetof( RibbonVertex, mColor ) );
+	glDrawArrays( GL_TRIANGLE_STRIP, 0, (GLsizei)count );
+	glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+	
+	mVbo.unbind();
 }
@@ -39,6 +39,7 @@
 #include "cinder/gl/Fbo.h"
 #include "cinder/gl/GlslProg.h"
 #include "cinder/params/Params.h"
+#include "BlurChain.h"
 #include "Cinder-LeapSdk.h"
 #include "Ribbon.h"
 
@@ -52,22 +53,25 @@ public:
 	void					shutdown();
 	void					update();
 private:
+	RibbonBatch				mRibbonBatch;
+	std::vector<Ribbon>		mRibbonPool;
 	RibbonMap				mRibbons;
+	std::vector<int32_t>	mTrackIds;
 
 	// Leap
-	uint32_t				mCallbackId;
-	LeapSdk::HandMap		mHands;
-	LeapSdk::DeviceRef		mLeap;
-	void 					onFrame( LeapSdk::Frame frame );
+	LeapSdk::DeviceRef			mLeap;
+	LeapSdk::PointableTracker	mTracker;
 
 	// Trails
-	ci::gl::Fbo				mFbo[ 3 ];
-	ci::gl::GlslProg		mShader[ 2 ];
+	BlurChain				mBlurChain;
+	ci::gl::Fbo				mFbo;
 
 	// Camera
 	ci::CameraPersp			mCamera;
 
 	// Params
+	int32_t					mBlurLevels;
+	int32_t					mBlurTaps;
 	float					mFrameRate;
 	bool					mFullScreen;
 	ci::params::InterfaceGl	mParams;
@@ -76,6 +80,7 @@ private:
 	void					screenShot();
 };
 
+#include <algorithm>
 #include "cinder/ImageIo.h"
 #include "cinder/Rand.h"
 #include "cinder/Utilities.h"
@@ -91,57 +96,38 @@ using namespace std;
 void TracerApp::draw()
 {
 	// Add to accumulation buffer
-	mFbo[ 0 ].bindFramebuffer();
-	gl::setViewport( mFbo[ 0 ].getBounds() );
-	gl::setMatricesWindow( mFbo[ 0 ].getSize() );
+	mFbo.bindFramebuffer();
+	gl::setViewport( mFbo.getBounds() );
+	gl::setMatricesWindow( mFbo.getSize() );
 	gl::enableAlphaBlending();
 
 	// Dim last frame
 	gl::color( ColorAf( Colorf::black(), 0.03f ) );
-	gl::drawSolidRect( Rectf( mFbo[ 0 ].getBounds() ) );
+	gl::drawSolidRect( Rectf( mFbo.getBounds() ) );
 
 	// Draw finger tips into the accumulation buffer
 	gl::setMatrices( mCamera );
 	gl::enableAdditiveBlending();
-	for ( RibbonMap::const_iterator iter = mRibbons.begin(); iter != mRibbons.end(); ++iter ) {
-		iter->second.draw();
-	}
-	mFbo[ 0 ].unbindFramebuffer();
+	mRibbonBatch.draw( mRibbons );
+	mFbo.unbindFramebuffer();
 
 	// Blur the accumulation buffer
-	gl::enable( GL_TEXTURE_2D );
-	gl::enableAlphaBlending();
-	gl::color( ColorAf::white() );
-	Vec2f pixel	= Vec2f::one() / Vec2f( mFbo[ 0 ].getSize() );
-	pixel		*= 3.0f;
-	for ( size_t i = 0; i < 2; ++i ) {
-		mFbo[ i + 1 ].bindFramebuffer();
-		gl::clear();
-		
-		mShader[ i ].bind();
-		mShader[ i ].uniform( "size",	pixel );
-		mShader[ i ].uniform( "tex",	0 );
-				
-		gl::Texture& texture = mFbo[ i ].getTexture();
-		texture.bind();
-		gl::drawSolidRect( Rectf( mFbo[ i ].getBounds() ) );
-		texture.unbind();
-		
-		mShader[ i ].unbind();
-		mFbo[ i + 1 ].unbindFramebuffer();
-	}
+	gl::Texture& blurred = mBlurChain.process( mFbo.getTexture() );
 
 	// Draw blurred image
+	gl::setViewport( getWindowBounds() );
 	gl::setMatricesWindow( getWindowSize(), false );
+	gl::enable( GL_TEXTURE_2D );
+	gl::enableAlphaBlending();
 	gl::color( ColorAf::white() );
-	mFbo[ 0 ].bindTexture();
+	mFbo.bindTexture();
 	gl::drawSolidRect( Rectf( getWindowBounds() ) );
-	mFbo[ 0 ].unbindTexture();
+	mFbo.unbindTexture();
 	
 	gl::color( ColorAf( Colorf::white(), 0.8f ) );
-	mFbo[ 2 ].bindTexture();
+	blurred.bind();
 	gl::drawSolidRect( Rectf( getWindowBounds() ) );
-	mFbo[ 2 ].unbindTexture();
+	blurred.unbind();
 	gl::disableAlphaBlending();
 	gl::disable( GL_TEXTURE_2D );
 
@@ -149,35 +135,30 @@ void TracerApp::draw()
 	mParams.draw();
 }
 
-// Called when Leap frame data is ready
-void TracerApp::onFrame( Frame frame )
-{
-	mHands = frame.getHands();
-}
-
 void TracerApp::onResize()
 {
 	// Enable polygon smoothing
 	gl::enable( GL_POLYGON_SMOOTH );
 	glHint( GL_POLYGON_SMOOTH_HINT, GL_NICEST );
 
-	// Set up FBOs
-	gl::Fbo::Format format;
+	// Set up FBOs only when the size really changed
+	if ( !mFbo || mFbo.getSize() != getWindowSize() ) {
+		gl::Fbo::Format format;
 #if defined( CINDER_MSW )
-	format.setColorInternalFormat( GL_RGBA32F );
+		format.setColorInternalFormat( GL_RGBA16F );
 #else
-	format.setColorInternalFormat( GL_RGBA32F_ARB );
+		format.setColorInternalFormat( GL_RGBA16F_ARB );
 #endif
-	format.setMinFilter( GL_LINEAR );
-	format.setMagFilter( GL_LINEAR );
-	format.setWrap( GL_CLAMP, GL_CLAMP );
-	for ( size_t i = 0; i < 3; ++i ) {
-		mFbo[ i ]	= gl::Fbo( getWindowWidth(), getWindowHeight(), format );
-		mFbo[ i ].bindFramebuffer();
-		gl::setViewport( mFbo[ i ].getBounds() );
+		format.setMinFilter( GL_LINEAR );
+		format.setMagFilter( GL_LINEAR );
+		format.setWrap( GL_CLAMP, GL_CLAMP );
+		mFbo = gl::Fbo( getWindowWidth(), getWindowHeight(), format );
+		mFbo.bindFramebuffer();
+		gl::setViewport( mFbo.getBounds() );
 		gl::clear();
-		mFbo[ i ].unbindFramebuffer();
+		mFbo.unbindFramebuffer();
 	}
+	mBlurChain.resize( getWindowSize() );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
 }
@@ -209,28 +190,25 @@ void TracerApp::setup()
 	
 	// Start device
 	mLeap		= Device::create();
-	mCallbackId = mLeap->addCallback( &TracerApp::onFrame, this );
 
 	// Load shaders
 	try {
-		mShader[ 0 ]	= gl::GlslProg( loadResource( RES_GLSL_PASS_THROUGH_VERT ), loadResource( RES_GLSL_BLUR_X_FRAG ) );
+		mBlurChain.setup( loadResource( RES_GLSL_PASS_THROUGH_VERT ), loadResource( RES_GLSL_BLUR_FRAG ) );
 	} catch ( gl::GlslProgCompileExc ex ) {
-		console() << "Unable to compile blur X shader: \n" << string( ex.what() ) << "\n";
-		quit();
-	}
-	try {
-		mShader[ 1 ]	= gl::GlslProg( loadResource( RES_GLSL_PASS_THROUGH_VERT ), loadResource( RES_GLSL_BLUR_Y_FRAG ) );
-	} catch ( gl::GlslProgCompileExc ex ) {
-		console() << "Unable to compile blur Y shader: \n" << string( ex.what() ) << "\n";
+		console() << "Unable to compile blur shader: \n" << string( ex.what() ) << "\n";
 		quit();
 	}
 
 	// Params
+	mBlurLevels	= (int32_t)mBlurChain.getLevels();
+	mBlurTaps	= (int32_t)mBlurChain.getTaps();
 	mFrameRate	= 0.0f;
 	mFullScreen	= true;
-	mParams = params::InterfaceGl( "Params", Vec2i( 200, 105 ) );
+	mParams = params::InterfaceGl( "Params", Vec2i( 200, 145 ) );
 	mParams.addParam( "Frame rate",		&mFrameRate,							"", true );
 	mParams.addParam( "Full screen",	&mFullScreen,							"key=f"		);
+	mParams.addParam( "Blur levels",	&mBlurLevels,							"min=1 max=4" );
+	mParams.addParam( "Blur taps",		&mBlurTaps,								"min=1 max=15 step=2" );
 	mParams.addButton( "Screen shot",	bind( &TracerApp::screenShot, this ),	"key=space" );
 	mParams.addButton( "Quit",			bind( &TracerApp::quit, this ),			"key=q" );
 
@@ -241,8 +219,7 @@ void TracerApp::setup()
 // Quit
 void TracerApp::shutdown()
 {
-	mLeap->removeCallback( mCallbackId );
-	mHands.clear();
+	mLeap.reset();
 }
 
 // Runs update logic
@@ -256,38 +233,69 @@ void TracerApp::update()
 		setFullScreen( mFullScreen );
 	}
 
-	// Update device
-	if ( mLeap && mLeap->isConnected() ) {		
+	// Apply blur settings
+	mBlurChain.setLevels( (size_t)mBlurLevels );
+	mBlurChain.setTaps( (size_t)mBlurTaps );
+	mBlurTaps = (int32_t)mBlurChain.getTaps();
+
+	// Update device. Sample fingers at render time so ribbons 
+	// advance evenly, however frames line up with the display.
+	Frame frame;
+	if ( mLeap ) {
 		mLeap->update();
+		frame = mLeap->getInterpolatedFrame();
 	}
-	
-	// Process hand data
-	for ( HandMap::const_iterator handIter = mHands.begin(); handIter != mHands.end(); ++handIter ) {
-		const Hand& hand = handIter->second;
-		
-		const FingerMap& fingers = hand.getFingers();
-		for ( FingerMap::const_iterator fingerIter = fingers.begin(); fingerIter != fingers.end(); ++fingerIter ) {
-			const Finger& finger = fingerIter->second;
-
-			int32_t id = fingerIter->first;
-			if ( mRibbons.find( id ) == mRibbons.end() ) {
+
+	// Track fingers in the same frame so a ribbon continues when 
+	// Leap gives a finger a new ID after losing it briefly
+	mTracker.update( frame );
+	mTrackIds.clear();
+	const vector<PointableTracker::Track>& tracks = mTracker.getTracks();
+	for ( vector<PointableTracker::Track>::const_iterator trackIter = tracks.begin(); trackIter != tracks.end(); ++trackIter ) {
+		const PointableTracker::Track& track = *trackIter;
+		if ( track.mTool ) {
+			continue;
+		}
+
+		// Coasting tracks keep their ribbon, but add no points
+		int32_t id = track.mId;
+		mTrackIds.push_back( id );
+		if ( track.mPointableId >= 0 ) {
+			RibbonMap::iterator ribbonIter = mRibbons.find( id );
+			if ( ribbonIter == mRibbons.end() ) {
 				Vec3f v = randVec3f() * 0.01f;
 				v.x = math<float>::abs( v.x );
 				v.y = math<float>::abs( v.y );
 				v.z = math<float>::abs( v.z );
 				Colorf color( ColorModel::CM_RGB, v );
-				Ribbon ribbon( id, color );
-				mRibbons[ id ] = ribbon;
+				
+				// Reuse a retired ribbon's storage if one is available
+				if ( mRibbonPool.empty() ) {
+					ribbonIter = mRibbons.insert( make_pair( id, Ribbon( id, color ) ) ).first;
+				} else {
+					mRibbonPool.back().reset( id, color );
+					ribbonIter = mRibbons.insert( make_pair( id, move( mRibbonPool.back() ) ) ).first;
+					mRibbonPool.pop_back();
+				}
 			}
-			float width = math<float>::abs( finger.getVelocity().y ) * 0.0025f;
+			float width = math<float>::abs( track.mVelocity.y ) * 0.0025f;
 			width		= math<float>::max( width, 5.0f );
-			mRibbons[ id ].addPoint( finger.getPosition(), width );
+			ribbonIter->second.addPoint( track.mPosition, width );
 		}
 	}
 
-	// Update ribbons
-	for ( RibbonMap::iterator iter = mRibbons.begin(); iter != mRibbons.end(); ++iter ) {
+	// Update ribbons. Retire those which have faded out after their
+	// finger left, so the map only grows with concurrent fingers.
+	sort( mTrackIds.begin(), mTrackIds.end() );
+	for ( RibbonMap::iterator iter = mRibbons.begin(); iter != mRibbons.end(); ) {
 		iter->second.update();
+		if ( iter->second.getPointCount() == 0 && 
+			!binary_search( mTrackIds.begin(), mTrackIds.end(), iter->first ) ) {
+			mRibbonPool.push_back( move( iter->second ) );
+			mRibbons.erase( iter++ );
+		} else {
+			++iter;
+		}
 	}
 }
 
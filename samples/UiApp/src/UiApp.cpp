@@ -53,6 +53,7 @@ private:
 	uint32_t				mCallbackId;
 	LeapSdk::HandMap		mHands;
 	LeapSdk::DeviceRef		mLeap;
+	LeapSdk::PoseClassifier	mPoseClassifier;
 	void 					onFrame( LeapSdk::Frame frame );
 	ci::Vec2f				warpPointable( const LeapSdk::Pointable& p );
 	ci::Vec2f				warpVector( const ci::Vec3f& v );
@@ -77,6 +78,10 @@ private:
 	ci::gl::Texture			mTrack;
 	ci::Vec2f				mTrackPosition;
 	
+	// Buttons are hit tested by index, the slider after them
+	LeapSdk::HitGrid		mHitGrid;
+	static const int32_t	SLIDER_ID = 3;
+	
 	// Params
 	float					mFrameRate;
 	bool					mFullScreen;
@@ -190,6 +195,7 @@ void UiApp::resize()
 	for ( size_t i = 0; i < 3; ++i, position.x += w ) {
 		mButtonPosition[ i ]	= position;
 		mButtonState[ i ]		= false;
+		mHitGrid.set( (int32_t)i, Rectf( mButton[ 0 ].getBounds() ).getOffset( position ) );
 	}
 
 	// Initialize slider
@@ -197,6 +203,7 @@ void UiApp::resize()
 	mTrackPosition		= position - Vec2f( mTrack.getSize() ) * 0.5f;
 	mSliderPosition		= mTrackPosition;
 	mSliderPosition.y	-= 45.0f;
+	mHitGrid.set( SLIDER_ID, Rectf( mSlider.getBounds() ).getOffset( mSliderPosition ) );
 }
 
 // Set up
@@ -206,7 +213,8 @@ void UiApp::setup()
 		
 	// Start device
 	mLeap 		= Device::create();
-	mCallbackId = mLeap->addCallback( &UiApp::onFrame, this );
+	mCallbackId = mLeap->addCallback( &UiApp::onFrame, this, Device::CALLBACK_THREAD_UPDATE, 
+										Frame::FIELD_PALM | Frame::FIELD_TIPS );
 	
 	// Load cursor textures
 	for ( size_t i = 0; i < 3; ++i ) {
@@ -281,7 +289,7 @@ void UiApp::update()
 	}
 
 	// Update device
-	if ( mLeap && mLeap->isConnected() ) {		
+	if ( mLeap ) {
 		mLeap->update();
 	}
 	
@@ -297,27 +305,28 @@ void UiApp::update()
 			mCursorPosition = mCursorPositionTarget;
 		}
 		
-		// Choose cursor type based on number of exposed fingers
-		switch ( hand.getFingers().size() ) {
-			case 0:
+		// Choose cursor type based on hand pose
+		switch ( mPoseClassifier.classify( HandDescriptor( hand ) ).mPose ) {
+			case PoseClassifier::POSE_FIST:
 				mCursorType	= CursorType::GRAB;
 				
 				// Slider
-				if ( mSlider.getBounds().contains( mCursorPosition - mSliderPosition ) ) {
+				if ( mHitGrid.hitTest( mCursorPosition ) == SLIDER_ID ) {
 					float x1			= mTrackPosition.x;
 					float x2			= mTrackPosition.x + (float)( mTrack.getWidth() - mSlider.getWidth() );
 					mSliderPosition.x	= math<float>::clamp( mCursorPosition.x, x1, x2 );
+					mHitGrid.set( SLIDER_ID, Rectf( mSlider.getBounds() ).getOffset( mSliderPosition ) );
 				}
 				break;
-			case 1:
+			case PoseClassifier::POSE_POINT:
 				mCursorType	= CursorType::TOUCH;
 				
 				// Buttons
-				mFingerTipPosition = warpPointable( hand.getFingers().begin()->second );
-				for ( size_t i = 0; i < 3; ++i ) {
-					mButtonState[ i ] = false;
-					if ( mButton[ 0 ].getBounds().contains( mFingerTipPosition - mButtonPosition[ i ] ) ) {
-						mButtonState[ i ] = true;
+				if ( !hand.getFingers().empty() ) {
+					mFingerTipPosition = warpPointable( hand.getFingers().begin()->second );
+					int32_t id = mHitGrid.hitTest( mFingerTipPosition );
+					for ( size_t i = 0; i < 3; ++i ) {
+						mButtonState[ i ] = id == (int32_t)i;
 					}
 				}
 				break;
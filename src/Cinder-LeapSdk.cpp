@@ -36,6 +36,25 @@
 
 #include "Cinder-LeapSdk.h"
 
+#include "boost/asio.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#if defined( CINDER_MSW )
+	#include <windows.h>
+#else
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
 using namespace ci;
 using namespace std;
 
@@ -43,6 +62,336 @@ namespace LeapSdk {
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
+Frame fromFrameSnapshot( const FrameSnapshot& s )
+{
+	Frame frame;
+	frame.mId			= s.mId;
+	frame.mTimestamp	= s.mTimestamp;
+
+	size_t gestureCount = math<size_t>::min( s.mGestureCount, FrameSnapshot::MAX_GESTURES );
+	for ( size_t i = 0; i < gestureCount; ++i ) {
+		frame.mGestures.push_back( s.mGestures[ i ] );
+	}
+	
+	size_t handCount = math<size_t>::min( s.mHandCount, FrameSnapshot::MAX_HANDS );
+	for ( size_t i = 0; i < handCount; ++i ) {
+		const FrameSnapshot::HandData& data = s.mHands[ i ];
+		Hand& hand				= frame.mHands[ data.mId ];
+		hand.mDirection			= data.mDirection;
+		hand.mId				= data.mId;
+		hand.mNormal			= data.mNormal;
+		hand.mPosition			= data.mPosition;
+		hand.mRotationAngle		= data.mRotationAngle;
+		hand.mRotationAxis		= data.mRotationAxis;
+		hand.mRotationMatrix	= data.mRotationMatrix;
+		hand.mScale				= data.mScale;
+		hand.mSpherePosition	= data.mSpherePosition;
+		hand.mSphereRadius		= data.mSphereRadius;
+		hand.mTranslation		= data.mTranslation;
+		hand.mVelocity			= data.mVelocity;
+	}
+
+	size_t pointableCount = math<size_t>::min( s.mPointableCount, FrameSnapshot::MAX_POINTABLES );
+	for ( size_t i = 0; i < pointableCount; ++i ) {
+		const FrameSnapshot::PointableData& data = s.mPointables[ i ];
+		HandMap::iterator iter = frame.mHands.find( data.mHandId );
+		if ( iter == frame.mHands.end() ) {
+			continue;
+		}
+		Pointable pointable;
+		pointable.mDirection	= data.mDirection;
+		pointable.mId			= data.mId;
+		pointable.mLength		= data.mLength;
+		pointable.mPosition		= data.mPosition;
+		pointable.mVelocity		= data.mVelocity;
+		pointable.mWidth		= data.mWidth;
+		if ( data.mTool != 0 ) {
+			iter->second.mTools[ data.mId ]		= Tool( pointable );
+		} else {
+			iter->second.mFingers[ data.mId ]	= Finger( pointable );
+		}
+	}
+	return frame;
+}
+
+static void toPointableData( const Pointable& p, int32_t handId, bool tool, FrameSnapshot* s )
+{
+	if ( s->mPointableCount >= FrameSnapshot::MAX_POINTABLES ) {
+		return;
+	}
+	FrameSnapshot::PointableData& data = s->mPointables[ s->mPointableCount++ ];
+	data.mDirection	= p.getDirection();
+	data.mHandId	= handId;
+	data.mId		= p.getId();
+	data.mLength	= p.getLength();
+	data.mPosition	= p.getPosition();
+	data.mTool		= tool ? 1 : 0;
+	data.mVelocity	= p.getVelocity();
+	data.mWidth		= p.getWidth();
+}
+
+void toFrameSnapshot( const Frame& f, FrameSnapshot* s )
+{
+	s->mId				= f.getId();
+	s->mTimestamp		= f.getTimestamp();
+	s->mGestureCount	= 0;
+	s->mHandCount		= 0;
+	s->mPointableCount	= 0;
+
+	const GestureList& gestures = f.getGestures();
+	for ( GestureList::const_iterator iter = gestures.begin(); iter != gestures.end(); ++iter ) {
+		if ( s->mGestureCount >= FrameSnapshot::MAX_GESTURES ) {
+			break;
+		}
+		s->mGestures[ s->mGestureCount++ ] = *iter;
+	}
+
+	const HandMap& hands = f.getHands();
+	for ( HandMap::const_iterator handIter = hands.begin(); handIter != hands.end(); ++handIter ) {
+		if ( s->mHandCount >= FrameSnapshot::MAX_HANDS ) {
+			break;
+		}
+		const Hand& hand = handIter->second;
+		FrameSnapshot::HandData& data = s->mHands[ s->mHandCount++ ];
+		data.mDirection			= hand.getDirection();
+		data.mId				= handIter->first;
+		data.mNormal			= hand.getNormal();
+		data.mPosition			= hand.getPosition();
+		data.mRotationAngle		= hand.getRotationAngle();
+		data.mRotationAxis		= hand.getRotationAxis();
+		data.mRotationMatrix	= hand.getRotationMatrix();
+		data.mScale				= hand.getScale();
+		data.mSpherePosition	= hand.getSpherePosition();
+		data.mSphereRadius		= hand.getSphereRadius();
+		data.mTranslation		= hand.getTranslation();
+		data.mVelocity			= hand.getVelocity();
+
+		const FingerMap& fingers = hand.getFingers();
+		for ( FingerMap::const_iterator iter = fingers.begin(); iter != fingers.end(); ++iter ) {
+			toPointableData( iter->second, data.mId, false, s );
+		}
+		const ToolMap& tools = hand.getTools();
+		for ( ToolMap::const_iterator iter = tools.begin(); iter != tools.end(); ++iter ) {
+			toPointableData( iter->second, data.mId, true, s );
+		}
+	}
+}
+
+// Gathers the values of matched hands and pointables into flat arrays, 
+// so that each kind of blend runs as one loop over all of them
+struct SnapshotBlend
+{
+	static const size_t	MAX_LERPS	= FrameSnapshot::MAX_HANDS * 10 + FrameSnapshot::MAX_POINTABLES * 8;
+	static const size_t	MAX_SLERPS	= FrameSnapshot::MAX_HANDS * 2 + FrameSnapshot::MAX_POINTABLES;
+
+	SnapshotBlend()
+		: mLerpCount( 0 ), mSlerpCount( 0 )
+	{
+	}
+
+	void apply( float t )
+	{
+		for ( size_t i = 0; i < mLerpCount; ++i ) {
+			mLerpFrom[ i ] += ( mLerpTo[ i ] - mLerpFrom[ i ] ) * t;
+		}
+		for ( size_t i = 0; i < mLerpCount; ++i ) {
+			*mLerpTargets[ i ] = mLerpFrom[ i ];
+		}
+
+		// Nearly parallel vectors fall back to a linear blend
+		for ( size_t i = 0; i < mSlerpCount; ++i ) {
+			float cosine	= mSlerpFrom[ 0 ][ i ] * mSlerpTo[ 0 ][ i ] + mSlerpFrom[ 1 ][ i ] * mSlerpTo[ 1 ][ i ] + mSlerpFrom[ 2 ][ i ] * mSlerpTo[ 2 ][ i ];
+			float angle		= math<float>::acos( math<float>::clamp( cosine, -1.0f, 1.0f ) );
+			float sine		= math<float>::sin( angle );
+			bool linear		= sine < 0.001f;
+			float a			= linear ? 1.0f - t : math<float>::sin( ( 1.0f - t ) * angle ) / sine;
+			float b			= linear ? t : math<float>::sin( t * angle ) / sine;
+			for ( size_t j = 0; j < 3; ++j ) {
+				mSlerpFrom[ j ][ i ] = mSlerpFrom[ j ][ i ] * a + mSlerpTo[ j ][ i ] * b;
+			}
+		}
+		for ( size_t i = 0; i < mSlerpCount; ++i ) {
+			mSlerpTargets[ i ]->set( mSlerpFrom[ 0 ][ i ], mSlerpFrom[ 1 ][ i ], mSlerpFrom[ 2 ][ i ] );
+		}
+	}
+
+	void lerp( float from, float to, float* target )
+	{
+		mLerpFrom[ mLerpCount ]		= from;
+		mLerpTargets[ mLerpCount ]	= target;
+		mLerpTo[ mLerpCount ]		= to;
+		++mLerpCount;
+	}
+
+	void lerp( const Vec3f& from, const Vec3f& to, Vec3f* target )
+	{
+		lerp( from.x, to.x, &target->x );
+		lerp( from.y, to.y, &target->y );
+		lerp( from.z, to.z, &target->z );
+	}
+
+	void slerp( const Vec3f& from, const Vec3f& to, Vec3f* target )
+	{
+		for ( size_t i = 0; i < 3; ++i ) {
+			mSlerpFrom[ i ][ mSlerpCount ]	= from[ i ];
+			mSlerpTo[ i ][ mSlerpCount ]	= to[ i ];
+		}
+		mSlerpTargets[ mSlerpCount ] = target;
+		++mSlerpCount;
+	}
+
+	size_t	mLerpCount;
+	float	mLerpFrom[ MAX_LERPS ];
+	float*	mLerpTargets[ MAX_LERPS ];
+	float	mLerpTo[ MAX_LERPS ];
+	size_t	mSlerpCount;
+	float	mSlerpFrom[ 3 ][ MAX_SLERPS ];
+	Vec3f*	mSlerpTargets[ MAX_SLERPS ];
+	float	mSlerpTo[ 3 ][ MAX_SLERPS ];
+};
+
+void interpolateFrameSnapshot( const FrameSnapshot& a, const FrameSnapshot& b, float t, FrameSnapshot* s )
+{
+	t				= math<float>::clamp( t, 0.0f, 1.0f );
+	bool nearA		= t < 0.5f;
+	const FrameSnapshot& other = nearA ? b : a;
+	*s				= nearA ? a : b;
+	s->mTimestamp	= a.mTimestamp + (int64_t)( (double)( b.mTimestamp - a.mTimestamp ) * (double)t );
+
+	SnapshotBlend blend;
+	uint32_t handCount = math<uint32_t>::min( s->mHandCount, (uint32_t)FrameSnapshot::MAX_HANDS );
+	for ( uint32_t i = 0; i < handCount; ++i ) {
+		FrameSnapshot::HandData& hand = s->mHands[ i ];
+		for ( uint32_t j = 0; j < other.mHandCount && j < FrameSnapshot::MAX_HANDS; ++j ) {
+			if ( other.mHands[ j ].mId == hand.mId ) {
+				const FrameSnapshot::HandData& from	= nearA ? hand : other.mHands[ j ];
+				const FrameSnapshot::HandData& to	= nearA ? other.mHands[ j ] : hand;
+				blend.lerp( from.mPosition, to.mPosition, &hand.mPosition );
+				blend.lerp( from.mSpherePosition, to.mSpherePosition, &hand.mSpherePosition );
+				blend.lerp( from.mSphereRadius, to.mSphereRadius, &hand.mSphereRadius );
+				blend.lerp( from.mVelocity, to.mVelocity, &hand.mVelocity );
+				blend.slerp( from.mDirection, to.mDirection, &hand.mDirection );
+				blend.slerp( from.mNormal, to.mNormal, &hand.mNormal );
+				break;
+			}
+		}
+	}
+	uint32_t pointableCount = math<uint32_t>::min( s->mPointableCount, (uint32_t)FrameSnapshot::MAX_POINTABLES );
+	for ( uint32_t i = 0; i < pointableCount; ++i ) {
+		FrameSnapshot::PointableData& pointable = s->mPointables[ i ];
+		for ( uint32_t j = 0; j < other.mPointableCount && j < FrameSnapshot::MAX_POINTABLES; ++j ) {
+			if ( other.mPointables[ j ].mId == pointable.mId ) {
+				const FrameSnapshot::PointableData& from	= nearA ? pointable : other.mPointables[ j ];
+				const FrameSnapshot::PointableData& to		= nearA ? other.mPointables[ j ] : pointable;
+				blend.lerp( from.mLength, to.mLength, &pointable.mLength );
+				blend.lerp( from.mPosition, to.mPosition, &pointable.mPosition );
+				blend.lerp( from.mVelocity, to.mVelocity, &pointable.mVelocity );
+				blend.lerp( from.mWidth, to.mWidth, &pointable.mWidth );
+				blend.slerp( from.mDirection, to.mDirection, &pointable.mDirection );
+				break;
+			}
+		}
+	}
+	blend.apply( t );
+}
+
+// Controller key, snapshot member and default of each config value
+struct ConfigKey
+{
+	const char*				mName;
+	float ConfigSnapshot::*	mValue;
+	float					mDefault;
+};
+
+static const ConfigKey kConfigKeys[] = {
+	{ "Gesture.Circle.MinArc",					&ConfigSnapshot::mCircleMinArc,					(float)M_PI * 1.5f },
+	{ "Gesture.Circle.MinRadius",				&ConfigSnapshot::mCircleMinRadius,				5.0f },
+	{ "Gesture.KeyTap.HistorySeconds",			&ConfigSnapshot::mKeyTapHistorySeconds,			0.1f },
+	{ "Gesture.KeyTap.MinDistance",				&ConfigSnapshot::mKeyTapMinDistance,			3.0f },
+	{ "Gesture.KeyTap.MinDownVelocity",			&ConfigSnapshot::mKeyTapMinDownVelocity,		50.0f },
+	{ "Gesture.ScreenTap.HistorySeconds",		&ConfigSnapshot::mScreenTapHistorySeconds,		0.1f },
+	{ "Gesture.ScreenTap.MinDistance",			&ConfigSnapshot::mScreenTapMinDistance,			5.0f },
+	{ "Gesture.ScreenTap.MinForwardVelocity",	&ConfigSnapshot::mScreenTapMinForwardVelocity,	50.0f },
+	{ "Gesture.Swipe.MinLength",				&ConfigSnapshot::mSwipeMinLength,				150.0f },
+	{ "Gesture.Swipe.MinVelocity",				&ConfigSnapshot::mSwipeMinVelocity,				1000.0f }
+};
+static const size_t kConfigKeyCount = sizeof( kConfigKeys ) / sizeof( kConfigKeys[ 0 ] );
+
+ConfigSnapshot fromLeapConfig( const Leap::Config& c )
+{
+	ConfigSnapshot config;
+	for ( size_t i = 0; i < kConfigKeyCount; ++i ) {
+		const ConfigKey& key = kConfigKeys[ i ];
+		switch ( c.type( key.mName ) ) {
+		case Leap::Config::TYPE_DOUBLE:
+			config.*key.mValue = (float)c.getDouble( key.mName );
+			break;
+		case Leap::Config::TYPE_FLOAT:
+			config.*key.mValue = c.getFloat( key.mName );
+			break;
+		case Leap::Config::TYPE_INT32:
+			config.*key.mValue = (float)c.getInt32( key.mName );
+			break;
+		default:
+			break;
+		}
+	}
+	return config;
+}
+
+// IDs of the first synthetic hand and, following it, its fingers
+static const int32_t kSyntheticHandId = 1000000;
+
+void synthesizeFrameSnapshot( int64_t id, int64_t timestamp, size_t handCount, FrameSnapshot* s )
+{
+	handCount = math<size_t>::min( handCount, (size_t)FrameSnapshot::MAX_HANDS );
+	handCount = math<size_t>::min( handCount, (size_t)FrameSnapshot::MAX_POINTABLES / 5 );
+
+	float t = (float)( (double)timestamp * 0.000001 );
+	for ( size_t i = 0; i < handCount; ++i ) {
+
+		// Hands sway out of phase, spaced across the controller
+		float phase		= (float)i * 1.3f;
+		float offset	= ( (float)i - (float)( handCount - 1 ) * 0.5f ) * 150.0f;
+		Vec3f position( offset + math<float>::sin( t * 0.5f + phase ) * 60.0f, 200.0f + math<float>::sin( t * 0.8f + phase ) * 15.0f, 0.0f );
+		Vec3f velocity( math<float>::cos( t * 0.5f + phase ) * 30.0f, math<float>::cos( t * 0.8f + phase ) * 12.0f, 0.0f );
+		int32_t handId	= kSyntheticHandId + (int32_t)i * 10;
+
+		FrameSnapshot::HandData& hand	= s->mHands[ i ];
+		hand.mDirection					= Vec3f( 0.0f, 0.0f, -1.0f );
+		hand.mId						= handId;
+		hand.mNormal					= Vec3f( 0.0f, -1.0f, 0.0f );
+		hand.mPosition					= position;
+		hand.mRotationAngle				= 0.0f;
+		hand.mRotationAxis				= Vec3f::zero();
+		hand.mRotationMatrix			= Matrix44f::identity();
+		hand.mScale						= 1.0f;
+		hand.mSpherePosition			= position + Vec3f( 0.0f, -30.0f, -40.0f );
+		hand.mSphereRadius				= 100.0f;
+		hand.mTranslation				= Vec3f::zero();
+		hand.mVelocity					= velocity;
+
+		// Thumb to little finger, spread across the palm
+		for ( size_t j = 0; j < 5; ++j ) {
+			FrameSnapshot::PointableData& finger	= s->mPointables[ i * 5 + j ];
+			Vec3f tip								= Vec3f( -50.0f + 25.0f * (float)j, 5.0f, j == 0 ? -40.0f : -80.0f );
+			finger.mDirection						= tip.normalized();
+			finger.mHandId							= handId;
+			finger.mId								= handId + 1 + (int32_t)j;
+			finger.mLength							= 50.0f;
+			finger.mPosition						= position + tip;
+			finger.mTool							= 0;
+			finger.mVelocity						= velocity;
+			finger.mWidth							= 15.0f;
+		}
+	}
+	s->mGestureCount	= 0;
+	s->mHandCount		= (uint32_t)handCount;
+	s->mId				= id;
+	s->mPointableCount	= (uint32_t)( handCount * 5 );
+	s->mTimestamp		= timestamp;
+}
+
 Finger fromLeapFinger( const Leap::Finger& f )
 {
 	return (Finger)Pointable( (Leap::Pointable)f );
@@ -63,9 +412,61 @@ Leap::Frame toLeapFrame( const Frame& f )
 	return f.mFrame;
 }
 
+GestureData fromLeapGesture( const Leap::Gesture& g )
+{
+	GestureData data;
+	data.mDuration	= g.duration();
+	data.mId		= g.id();
+	data.mState		= g.state();
+	data.mType		= g.type();
+	switch ( data.mType ) {
+	case Leap::Gesture::TYPE_CIRCLE:
+		{
+			Leap::CircleGesture circle( g );
+			data.mDirection		= fromLeapVector( circle.normal() );
+			data.mPointableId	= circle.pointable().id();
+			data.mPosition		= fromLeapVector( circle.center() );
+			data.mProgress		= circle.progress();
+			data.mRadius		= circle.radius();
+		}
+		break;
+	case Leap::Gesture::TYPE_KEY_TAP:
+		{
+			Leap::KeyTapGesture tap( g );
+			data.mDirection		= fromLeapVector( tap.direction() );
+			data.mPointableId	= tap.pointable().id();
+			data.mPosition		= fromLeapVector( tap.position() );
+			data.mProgress		= tap.progress();
+		}
+		break;
+	case Leap::Gesture::TYPE_SCREEN_TAP:
+		{
+			Leap::ScreenTapGesture tap( g );
+			data.mDirection		= fromLeapVector( tap.direction() );
+			data.mPointableId	= tap.pointable().id();
+			data.mPosition		= fromLeapVector( tap.position() );
+			data.mProgress		= tap.progress();
+		}
+		break;
+	case Leap::Gesture::TYPE_SWIPE:
+		{
+			Leap::SwipeGesture swipe( g );
+			data.mDirection		= fromLeapVector( swipe.direction() );
+			data.mPointableId	= swipe.pointable().id();
+			data.mPosition		= fromLeapVector( swipe.position() );
+			data.mSpeed			= swipe.speed();
+			data.mStartPosition	= fromLeapVector( swipe.startPosition() );
+		}
+		break;
+	default:
+		break;
+	}
+	return data;
+}
+
 Hand fromLeapHand( const Leap::Hand& h, const Leap::Frame& f )
 {
-	return Hand( h, f );
+	return Hand( h, f, Frame::FIELD_ALL );
 }
 
 Leap::Hand toLeapHand( const Hand& h )
@@ -160,41 +561,64 @@ Leap::Vector toLeapVector( const Vec3f& v )
 
 Pointable::Pointable()
 {
+	mDirection	= Vec3f::zero();
+	mId			= -1;
+	mLength		= 0.0f;
+	mPosition	= Vec3f::zero();
+	mVelocity	= Vec3f::zero();
+	mWidth		= 0.0f;
 }
 	
 Pointable::Pointable( const Leap::Pointable& p )
 {
-	mPointable = p;
+	mDirection	= fromLeapVector( p.direction() );
+	mId			= p.id();
+	mLength		= (float)p.length();
+	mPointable	= p;
+	mPosition	= fromLeapVector( p.tipPosition() );
+	mVelocity	= fromLeapVector( p.tipVelocity() );
+	mWidth		= (float)p.width();
 }
 	
 Pointable::Pointable( const Pointable& p )
 {
+	mDirection	= p.mDirection;
+	mId			= p.mId;
+	mLength		= p.mLength;
 	mPointable	= p.mPointable;
+	mPosition	= p.mPosition;
+	mVelocity	= p.mVelocity;
+	mWidth		= p.mWidth;
 }
 	
-Vec3f Pointable::getDirection() const
+const Vec3f& Pointable::getDirection() const
 {
-	return fromLeapVector( mPointable.direction() );
+	return mDirection;
+}
+
+int32_t Pointable::getId() const
+{
+	return mId;
 }
 
 float Pointable::getLength() const
 {
-	return (float)mPointable.length();
+	return mLength;
 }
 
-Vec3f Pointable::getPosition() const
+const Vec3f& Pointable::getPosition() const
 {
-return fromLeapVector( mPointable.tipPosition() );
+	return mPosition;
 }
 
-Vec3f Pointable::getVelocity() const
+const Vec3f& Pointable::getVelocity() const
 {
-	return fromLeapVector( mPointable.tipVelocity() );
+	return mVelocity;
 }
 
 float Pointable::getWidth() const
 {
-return (float)mPointable.width();
+	return mWidth;
 }
 
 Finger::Finger()
@@ -221,29 +645,68 @@ Tool::Tool( const Pointable& p )
 
 Hand::Hand()
 {
+	mDirection		= Vec3f::zero();
+	mId				= -1;
+	mNormal			= Vec3f::zero();
+	mPosition		= Vec3f::zero();
+	mRotationAngle	= 0.0f;
+	mRotationAxis	= Vec3f::zero();
+	mScale			= 1.0f;
+	mSpherePosition	= Vec3f::zero();
+	mSphereRadius	= 0.0f;
+	mTranslation	= Vec3f::zero();
+	mVelocity		= Vec3f::zero();
 }
 	
-Hand::Hand( const Leap::Hand& h, const Leap::Frame& f )
+Hand::Hand( const Leap::Hand& h, const Leap::Frame& f, uint32_t fields )
 {
-	mHand = h;
-	const Leap::PointableList& pointables = h.pointables();
-	for ( Leap::PointableList::const_iterator ptIter = pointables.begin(); ptIter != pointables.end(); ++ptIter ) {
-		const Leap::Pointable& pt = *ptIter;
-		if ( pt.isValid() ) {
-			Pointable pointable( pt );
-			if ( pt.isFinger() ) {
-				mFingers[ pt.id() ] = Finger( pointable );
-			} else if ( pt.isTool() ) {
-				mTools[ pt.id() ] = Tool( pointable );
+	TraceSpan span( "Hand::Hand" );
+	mHand			= h;
+	mId				= h.id();
+	if ( ( fields & Frame::FIELD_PALM ) != 0 ) {
+		mDirection		= fromLeapVector( h.direction() );
+		mNormal			= fromLeapVector( h.palmNormal() );
+		mPosition		= fromLeapVector( h.palmPosition() );
+		mSpherePosition	= fromLeapVector( h.sphereCenter() );
+		mSphereRadius	= (float)h.sphereRadius();
+		mVelocity		= fromLeapVector( h.palmVelocity() );
+	} else {
+		mDirection		= Vec3f::zero();
+		mNormal			= Vec3f::zero();
+		mPosition		= Vec3f::zero();
+		mSpherePosition	= Vec3f::zero();
+		mSphereRadius	= 0.0f;
+		mVelocity		= Vec3f::zero();
+	}
+
+	bool fingers	= ( fields & Frame::FIELD_TIPS ) != 0;
+	bool tools		= ( fields & Frame::FIELD_TOOLS ) != 0;
+	if ( fingers || tools ) {
+		const Leap::PointableList& pointables = h.pointables();
+		for ( Leap::PointableList::const_iterator ptIter = pointables.begin(); ptIter != pointables.end(); ++ptIter ) {
+			const Leap::Pointable& pt = *ptIter;
+			if ( pt.isValid() ) {
+				if ( fingers && pt.isFinger() ) {
+					mFingers[ pt.id() ] = Finger( Pointable( pt ) );
+				} else if ( tools && pt.isTool() ) {
+					mTools[ pt.id() ] = Tool( Pointable( pt ) );
+				}
 			}
 		}
 	}
 	
-	mRotationAngle		= (float)h.rotationAngle( f );
-	mRotationAxis		= fromLeapVector( h.rotationAxis( f ) );
-	mRotationMatrix		= fromLeapMatrix44( h.rotationMatrix( f ) );
-	mScale				= (float)h.scaleFactor( f );
-	mTranslation		= fromLeapVector( h.translation( f ) );
+	if ( ( fields & Frame::FIELD_MOTION ) != 0 ) {
+		mRotationAngle		= (float)h.rotationAngle( f );
+		mRotationAxis		= fromLeapVector( h.rotationAxis( f ) );
+		mRotationMatrix		= fromLeapMatrix44( h.rotationMatrix( f ) );
+		mScale				= (float)h.scaleFactor( f );
+		mTranslation		= fromLeapVector( h.translation( f ) );
+	} else {
+		mRotationAngle		= 0.0f;
+		mRotationAxis		= Vec3f::zero();
+		mScale				= 1.0f;
+		mTranslation		= Vec3f::zero();
+	}
 }
 
 Hand::~Hand()
@@ -252,9 +715,9 @@ Hand::~Hand()
 	mTools.clear();
 }
 
-Vec3f Hand::getDirection() const
+const Vec3f& Hand::getDirection() const
 {
-	return fromLeapVector( mHand.direction() );
+	return mDirection;
 }
 
 const FingerMap& Hand::getFingers() const
@@ -262,14 +725,19 @@ const FingerMap& Hand::getFingers() const
 	return mFingers;
 }
 
-Vec3f Hand::getNormal() const
+int32_t Hand::getId() const
+{
+	return mId;
+}
+
+const Vec3f& Hand::getNormal() const
 {
-	return fromLeapVector( mHand.palmNormal() );
+	return mNormal;
 }
 
-Vec3f Hand::getPosition() const
+const Vec3f& Hand::getPosition() const
 {
-	return fromLeapVector( mHand.palmPosition() );
+	return mPosition;
 }
 
 float Hand::getRotationAngle() const
@@ -312,14 +780,14 @@ float Hand::getScale( const Frame& f ) const
 	return (float)mHand.scaleFactor( f.mFrame );
 }
 	
-Vec3f Hand::getSpherePosition() const
+const Vec3f& Hand::getSpherePosition() const
 {
-	return fromLeapVector( mHand.sphereCenter() );
+	return mSpherePosition;
 }
 
 float Hand::getSphereRadius() const
 {
-	return (float)mHand.sphereRadius();
+	return mSphereRadius;
 }
 
 const ToolMap& Hand::getTools() const
@@ -337,32 +805,44 @@ Vec3f Hand::getTranslation( const Frame& f ) const
 	return fromLeapVector( mHand.translation( f.mFrame ) );
 }
 
-Vec3f Hand::getVelocity() const
+const Vec3f& Hand::getVelocity() const
 {
-	return fromLeapVector( mHand.palmVelocity() );
+	return mVelocity;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 Frame::Frame()
 {
+	mFields		= FIELD_ALL;
+	mId			= -1;
+	mTimestamp	= 0;
 }
 
-Frame::Frame( const Leap::Frame& frame )
+Frame::Frame( const Leap::Frame& frame, uint32_t fields )
 {
-	mFrame	= frame;
+	TraceSpan span( "Frame::Frame" );
+	mFields		= fields;
+	mFrame		= frame;
+	mId			= frame.id();
+	mTimestamp	= frame.timestamp();
 	
+	// Decode gestures once so reading them never calls into Leap
 	mGestures.clear();
-	Leap::GestureList gestures = mFrame.gestures();
-	for ( Leap::GestureList::const_iterator iter = gestures.begin(); iter != gestures.end(); ++iter ) {
-		mGestures.push_back( *iter );
+	if ( ( fields & FIELD_GESTURES ) != 0 ) {
+		Leap::GestureList gestures = mFrame.gestures();
+		for ( Leap::GestureList::const_iterator iter = gestures.begin(); iter != gestures.end(); ++iter ) {
+			if ( !mGestures.push_back( fromLeapGesture( *iter ) ) ) {
+				break;
+			}
+		}
 	}
 	
 	mHands.clear();
 	Leap::HandList hands = mFrame.hands();
 	for ( Leap::HandList::const_iterator iter = hands.begin(); iter != hands.end(); ++iter ) {
 		const Leap::Hand& hand	= *iter;
-		mHands[ hand.id() ]		= Hand( hand, frame );
+		mHands[ hand.id() ]		= Hand( hand, frame, fields );
 	}
 }
 	
@@ -371,11 +851,16 @@ Frame::~Frame()
 	mHands.clear();
 }
 
-const vector<Leap::Gesture>& Frame::getGestures() const
+const GestureList& Frame::getGestures() const
 {
 	return mGestures;
 }
 	
+uint32_t Frame::getFields() const
+{
+	return mFields;
+}
+
 const HandMap& Frame::getHands() const
 {
 	return mHands;
@@ -383,15 +868,185 @@ const HandMap& Frame::getHands() const
 
 int64_t Frame::getId() const
 {
-	return mFrame.id();
+	return mId;
 }
 
 int64_t Frame::getTimestamp() const
 {
-	return mFrame.timestamp();
+	return mTimestamp;
 }
 
 	
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+GestureData::GestureData()
+	: mDirection( Vec3f::zero() ), mDuration( 0 ), mId( -1 ), mPointableId( -1 ), 
+	mPosition( Vec3f::zero() ), mProgress( 0.0f ), mRadius( 0.0f ), mSpeed( 0.0f ), 
+	mStartPosition( Vec3f::zero() ), mState( Leap::Gesture::STATE_INVALID ), 
+	mType( Leap::Gesture::TYPE_INVALID )
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+GestureList::GestureList()
+	: mCount( 0 )
+{
+}
+
+GestureList::GestureList( const GestureList& rhs )
+{
+	*this = rhs;
+}
+
+GestureList& GestureList::operator=( const GestureList& rhs )
+{
+	// Only the gestures in use are copied
+	mCount = rhs.mCount;
+	copy( rhs.mGestures, rhs.mGestures + mCount, mGestures );
+	return *this;
+}
+
+const GestureData& GestureList::operator[]( size_t index ) const
+{
+	return mGestures[ index ];
+}
+
+GestureList::const_iterator GestureList::begin() const
+{
+	return mGestures;
+}
+
+void GestureList::clear()
+{
+	mCount = 0;
+}
+
+bool GestureList::empty() const
+{
+	return mCount == 0;
+}
+
+GestureList::const_iterator GestureList::end() const
+{
+	return mGestures + mCount;
+}
+
+bool GestureList::push_back( const GestureData& gesture )
+{
+	if ( mCount >= MAX_SIZE ) {
+		return false;
+	}
+	mGestures[ mCount++ ] = gesture;
+	return true;
+}
+
+size_t GestureList::size() const
+{
+	return mCount;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+GestureRouter::GestureRouter()
+	: mFrameId( -1 ), mNextId( 0 )
+{
+}
+
+uint32_t GestureRouter::addHandler( Gesture::Type type, const Handler& handler )
+{
+	uint32_t id = mNextId++;
+	mRoutes[ (int32_t)type ].mHandlers.push_back( make_pair( id, handler ) );
+	return id;
+}
+
+uint32_t GestureRouter::addHandler( Gesture::Type type, const Rectf& region, const Handler& handler )
+{
+	if ( region.getWidth() == 0.0f && region.getHeight() == 0.0f ) {
+		return addHandler( type, handler );
+	}
+	uint32_t id = mNextId++;
+	Route& route = mRoutes[ (int32_t)type ];
+	route.mRegionHandlers[ id ] = handler;
+	route.mRegions.set( (int32_t)id, region );
+	return id;
+}
+
+void GestureRouter::removeHandler( uint32_t id )
+{
+	for ( map<int32_t, Route>::iterator iter = mRoutes.begin(); iter != mRoutes.end(); ++iter ) {
+		Route& route = iter->second;
+		if ( route.mRegionHandlers.erase( id ) > 0 ) {
+			route.mRegions.remove( (int32_t)id );
+			return;
+		}
+		for ( size_t i = 0; i < route.mHandlers.size(); ++i ) {
+			if ( route.mHandlers[ i ].first == id ) {
+				route.mHandlers.erase( route.mHandlers.begin() + i );
+				return;
+			}
+		}
+	}
+}
+
+void GestureRouter::route( const Frame& frame )
+{
+	if ( frame.getId() == mFrameId ) {
+		return;
+	}
+	mFrameId = frame.getId();
+
+	const GestureList& gestures	= frame.getGestures();
+	int64_t timestamp			= frame.getTimestamp();
+	for ( GestureList::const_iterator iter = gestures.begin(); iter != gestures.end(); ++iter ) {
+		const GestureData& gesture = *iter;
+
+		// Skip starts and stops which were already delivered
+		map<int32_t, State>::iterator state = mStates.find( gesture.mId );
+		if ( state != mStates.end() ) {
+			state->second.mTimestamp = timestamp;
+			if ( state->second.mState == gesture.mState && gesture.mState != Leap::Gesture::STATE_UPDATE ) {
+				continue;
+			}
+			state->second.mState = gesture.mState;
+		} else {
+			State s;
+			s.mState		= gesture.mState;
+			s.mTimestamp	= timestamp;
+			mStates[ gesture.mId ] = s;
+		}
+
+		map<int32_t, Route>::iterator route = mRoutes.find( (int32_t)gesture.mType );
+		if ( route == mRoutes.end() ) {
+			continue;
+		}
+		const vector<pair<uint32_t, Handler> >& handlers = route->second.mHandlers;
+		for ( vector<pair<uint32_t, Handler> >::const_iterator handler = handlers.begin(); handler != handlers.end(); ++handler ) {
+			handler->second( gesture );
+		}
+		if ( mProjection && route->second.mRegions.getCount() > 0 ) {
+			int32_t id = route->second.mRegions.hitTest( mProjection( gesture.mPosition ) );
+			if ( id >= 0 ) {
+				route->second.mRegionHandlers[ (uint32_t)id ]( gesture );
+			}
+		}
+	}
+
+	// Forget gestures which have not been seen for a second
+	for ( map<int32_t, State>::iterator iter = mStates.begin(); iter != mStates.end(); ) {
+		if ( timestamp - iter->second.mTimestamp > 1000000 ) {
+			mStates.erase( iter++ );
+		} else {
+			++iter;
+		}
+	}
+}
+
+void GestureRouter::setProjection( const function<Vec2f ( const Vec3f& )>& projection )
+{
+	mProjection = projection;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 Screen::Screen()
@@ -472,147 +1127,3945 @@ Vec3f Screen::project( const Vec3f& v, bool normalize, float clampRatio ) const
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
-Listener::Listener()
-{
-	mConnected			= false;
-	mExited				= false;
-	mFirstFrameReceived	= false;
-	mInitialized		= false;
-	mNewFrame			= false;
-}
-
-void Listener::onConnect( const Leap::Controller& controller ) 
+HitGrid::HitGrid( float cellSize )
+	: mCellSize( math<float>::max( cellSize, 1.0f ) )
 {
-	lock_guard<mutex> lock( *mMutex );
-	mConnected = true;
 }
 
-void Listener::onDisconnect( const Leap::Controller& controller ) 
-{
-	lock_guard<mutex> lock( *mMutex );
-	mConnected = false;
-}
-	
-void Listener::onExit( const Leap::Controller& controller )
+void HitGrid::clear()
 {
-	lock_guard<mutex> lock( *mMutex );
-	mExited = true;
+	mCells.clear();
+	mTargets.clear();
 }
 
-void Listener::onFrame( const Leap::Controller& controller ) 
+void HitGrid::erase( int32_t id, const Rectf& bounds )
 {
-	lock_guard<mutex> lock( *mMutex );
-	if ( !mNewFrame ) {
-		const Leap::Frame& frame	= controller.frame();
-		
-		mFrame						= Frame( frame );
-		if ( !mFirstFrameReceived ) {
-			mFirstFrame			= mFrame;
-			mFirstFrameReceived	= true;
+	int32_t x2 = toCell( bounds.x2 );
+	int32_t y2 = toCell( bounds.y2 );
+	for ( int32_t y = toCell( bounds.y1 ); y <= y2; ++y ) {
+		for ( int32_t x = toCell( bounds.x1 ); x <= x2; ++x ) {
+			CellMap::iterator iter = mCells.find( toKey( x, y ) );
+			if ( iter != mCells.end() ) {
+				vector<Target>& targets = iter->second;
+				for ( size_t i = 0; i < targets.size(); ++i ) {
+					if ( targets[ i ].mId == id ) {
+						targets[ i ] = targets.back();
+						targets.pop_back();
+						break;
+					}
+				}
+				if ( targets.empty() ) {
+					mCells.erase( iter );
+				}
+			}
 		}
-		mNewFrame	= true;
 	}
 }
 
-void Listener::onInit( const Leap::Controller& controller ) 
+float HitGrid::getCellSize() const
 {
-	lock_guard<mutex> lock( *mMutex );
-	mInitialized = true;
+	return mCellSize;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////
-
-DeviceRef Device::create()
+size_t HitGrid::getCount() const
 {
-	return DeviceRef( new Device() );
+	return mTargets.size();
 }
 
-Device::Device()
+int32_t HitGrid::hitTest( const Vec2f& point ) const
 {
-	mListener.mMutex	= &mMutex;
-	mController			= new Leap::Controller( mListener );
+	CellMap::const_iterator iter = mCells.find( toKey( toCell( point.x ), toCell( point.y ) ) );
+	if ( iter == mCells.end() ) {
+		return -1;
+	}
+	int32_t id = -1;
+	const vector<Target>& targets = iter->second;
+	for ( vector<Target>::const_iterator target = targets.begin(); target != targets.end(); ++target ) {
+		if ( ( id < 0 || target->mId < id ) && target->mBounds.contains( point ) ) {
+			id = target->mId;
+		}
+	}
+	return id;
 }
 
-Device::~Device()
+size_t HitGrid::hitTest( const vector<Vec2f>& points, vector<int32_t>* ids ) const
 {
-	for ( CallbackList::const_iterator iter = mCallbacks.begin(); iter != mCallbacks.end(); ++iter ) {
-		iter->second->disconnect();
+	size_t count = 0;
+	ids->resize( points.size() );
+	for ( size_t i = 0; i < points.size(); ++i ) {
+		int32_t id		= hitTest( points[ i ] );
+		( *ids )[ i ]	= id;
+		if ( id >= 0 ) {
+			++count;
+		}
 	}
-	mCallbacks.clear();
+	return count;
 }
 
-void Device::enableGesture( Gesture::Type t )
+void HitGrid::insert( int32_t id, const Rectf& bounds )
 {
-	if ( mController != 0 ) {
-		mController->enableGesture( t );
+	Target target;
+	target.mBounds	= bounds;
+	target.mId		= id;
+
+	int32_t x2 = toCell( bounds.x2 );
+	int32_t y2 = toCell( bounds.y2 );
+	for ( int32_t y = toCell( bounds.y1 ); y <= y2; ++y ) {
+		for ( int32_t x = toCell( bounds.x1 ); x <= x2; ++x ) {
+			mCells[ toKey( x, y ) ].push_back( target );
+		}
 	}
 }
 
-const Screen& Device::getClosestScreen( const Pointable& p ) const
+void HitGrid::remove( int32_t id )
 {
-	const Leap::ScreenList& screens = mController->calibratedScreens();
-	if ( screens.empty() ) {
-		throw ExcNoCalibratedScreens();
-	}
-	Leap::Screen closestScreen = screens.closestScreenHit( p.mPointable );
-	for ( ScreenMap::const_iterator iter = mScreens.begin(); iter != mScreens.end(); ++iter ) {
-		const Screen& screen = iter->second;
-		if ( screen.mScreen.id() == closestScreen.id() ) {
-			return screen;
-		}
-	}
-	if ( mScreens.begin() != mScreens.end() ) {
-		return mScreens.begin()->second;
+	map<int32_t, Rectf>::iterator iter = mTargets.find( id );
+	if ( iter != mTargets.end() ) {
+		erase( id, iter->second );
+		mTargets.erase( iter );
 	}
-	throw ExcNoClosestScreen();
 }
-	
-Leap::Config Device::getConfig() const
+
+void HitGrid::set( int32_t id, const Rectf& bounds )
 {
-	return mController->config();
+	Rectf rect = bounds.canonicalized();
+	map<int32_t, Rectf>::iterator iter = mTargets.find( id );
+	if ( iter != mTargets.end() ) {
+		erase( id, iter->second );
+		iter->second = rect;
+	} else {
+		mTargets[ id ] = rect;
+	}
+	insert( id, rect );
 }
-	
-const ScreenMap& Device::getScreens() const
+
+void HitGrid::setCellSize( float cellSize )
 {
-	return mScreens;
+	mCellSize = math<float>::max( cellSize, 1.0f );
+	mCells.clear();
+	for ( map<int32_t, Rectf>::const_iterator iter = mTargets.begin(); iter != mTargets.end(); ++iter ) {
+		insert( iter->first, iter->second );
+	}
 }
 
-bool Device::hasExited() const
+int32_t HitGrid::toCell( float v ) const
 {
-	return mListener.mExited;
+	return (int32_t)math<float>::floor( v / mCellSize );
 }
-	
-bool Device::isConnected() const
+
+uint64_t HitGrid::toKey( int32_t x, int32_t y )
 {
-	return mListener.mConnected;
+	return ( (uint64_t)(uint32_t)x << 32 ) | (uint64_t)(uint32_t)y;
 }
 
-bool Device::isInitialized() const
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Frames with more points than this are indexed with a k-d tree. A 
+// frame holds at most 48 points. Below about 16 a scan is faster.
+static const size_t kFrameIndexTreeSize	= 16;
+// Points whose distances are computed together in a linear scan
+static const size_t kFrameIndexBlockSize	= 16;
+
+FrameIndex::FrameIndex()
+	: mTree( false )
 {
-	return mListener.mInitialized;
 }
 
-void Device::removeCallback( uint32_t id )
+void FrameIndex::add( const Vec3f& position, int32_t handId, int32_t id, PointType type )
 {
-	if ( mCallbacks.find( id ) != mCallbacks.end() ) {
-		mCallbacks.find( id )->second->disconnect();
-		mCallbacks.erase( id ); 
-	}
+	Match point;
+	point.mDistance	= 0.0f;
+	point.mHandId	= handId;
+	point.mId		= id;
+	point.mPosition	= position;
+	point.mType		= type;
+	mPoints.push_back( point );
 }
 
-void Device::update()
+void FrameIndex::build( const Frame& frame, uint32_t types )
 {
-	lock_guard<mutex> lock( mMutex );
-	if ( mListener.mNewFrame ) {
-		mSignal( mListener.mFrame );
-		mListener.mNewFrame = false;
-	}
-	const Leap::ScreenList& screens = mController->calibratedScreens();
-	mScreens.clear();
-	size_t count = screens.count();
+	mPoints.clear();
+	const HandMap& hands = frame.getHands();
+	for ( HandMap::const_iterator handIter = hands.begin(); handIter != hands.end(); ++handIter ) {
+		const Hand& hand = handIter->second;
+		if ( ( types & POINT_TYPE_PALM ) != 0 ) {
+			add( hand.getPosition(), handIter->first, -1, POINT_TYPE_PALM );
+		}
+		if ( ( types & POINT_TYPE_FINGER ) != 0 ) {
+			const FingerMap& fingers = hand.getFingers();
+			for ( FingerMap::const_iterator iter = fingers.begin(); iter != fingers.end(); ++iter ) {
+				add( iter->second.getPosition(), handIter->first, iter->first, POINT_TYPE_FINGER );
+			}
+		}
+		if ( ( types & POINT_TYPE_TOOL ) != 0 ) {
+			const ToolMap& tools = hand.getTools();
+			for ( ToolMap::const_iterator iter = tools.begin(); iter != tools.end(); ++iter ) {
+				add( iter->second.getPosition(), handIter->first, iter->first, POINT_TYPE_TOOL );
+			}
+		}
+	}
+
+	mAxes.assign( mPoints.size(), 0 );
+	mTree = mPoints.size() > kFrameIndexTreeSize;
+	if ( mTree ) {
+		split( 0, mPoints.size() );
+	}
+
+	mX.resize( mPoints.size() );
+	mY.resize( mPoints.size() );
+	mZ.resize( mPoints.size() );
+	for ( size_t i = 0; i < mPoints.size(); ++i ) {
+		mX[ i ] = mPoints[ i ].mPosition.x;
+		mY[ i ] = mPoints[ i ].mPosition.y;
+		mZ[ i ] = mPoints[ i ].mPosition.z;
+	}
+}
+
+void FrameIndex::clear()
+{
+	mAxes.clear();
+	mPoints.clear();
+	mTree = false;
+	mX.clear();
+	mY.clear();
+	mZ.clear();
+}
+
+size_t FrameIndex::findNearest( const Vec3f& position, size_t count, vector<Match>* matches ) const
+{
+	matches->clear();
+	count = math<size_t>::min( count, mPoints.size() );
+	if ( count == 0 ) {
+		return 0;
+	}
+	matches->reserve( count );
+
+	// Distances stay squared until the search is done
+	if ( mTree ) {
+		searchNearest( 0, mPoints.size(), position, count, matches );
+	} else {
+		float distances[ kFrameIndexBlockSize ];
+		for ( size_t i = 0; i < mPoints.size(); i += kFrameIndexBlockSize ) {
+			size_t n = math<size_t>::min( kFrameIndexBlockSize, mPoints.size() - i );
+			for ( size_t j = 0; j < n; ++j ) {
+				float x				= mX[ i + j ] - position.x;
+				float y				= mY[ i + j ] - position.y;
+				float z				= mZ[ i + j ] - position.z;
+				distances[ j ]		= x * x + y * y + z * z;
+			}
+			for ( size_t j = 0; j < n; ++j ) {
+				if ( matches->size() < count || distances[ j ] < matches->back().mDistance ) {
+					insert( i + j, distances[ j ], count, matches );
+				}
+			}
+		}
+	}
+	for ( vector<Match>::iterator iter = matches->begin(); iter != matches->end(); ++iter ) {
+		iter->mDistance = math<float>::sqrt( iter->mDistance );
+	}
+	return matches->size();
+}
+
+size_t FrameIndex::findWithinRadius( const Vec3f& position, float radius, vector<Match>* matches ) const
+{
+	matches->clear();
+	if ( mPoints.empty() || radius < 0.0f ) {
+		return 0;
+	}
+
+	float radiusSquared = radius * radius;
+	if ( mTree ) {
+		searchRadius( 0, mPoints.size(), position, radiusSquared, matches );
+	} else {
+		float distances[ kFrameIndexBlockSize ];
+		for ( size_t i = 0; i < mPoints.size(); i += kFrameIndexBlockSize ) {
+			size_t n = math<size_t>::min( kFrameIndexBlockSize, mPoints.size() - i );
+			for ( size_t j = 0; j < n; ++j ) {
+				float x				= mX[ i + j ] - position.x;
+				float y				= mY[ i + j ] - position.y;
+				float z				= mZ[ i + j ] - position.z;
+				distances[ j ]		= x * x + y * y + z * z;
+			}
+			for ( size_t j = 0; j < n; ++j ) {
+				if ( distances[ j ] <= radiusSquared ) {
+					matches->push_back( mPoints[ i + j ] );
+					matches->back().mDistance = distances[ j ];
+				}
+			}
+		}
+	}
+	
+	sort( matches->begin(), matches->end(), []( const Match& a, const Match& b )
+	{
+		return a.mDistance < b.mDistance;
+	} );
+	for ( vector<Match>::iterator iter = matches->begin(); iter != matches->end(); ++iter ) {
+		iter->mDistance = math<float>::sqrt( iter->mDistance );
+	}
+	return matches->size();
+}
+
+size_t FrameIndex::getCount() const
+{
+	return mPoints.size();
+}
+
+// Keeps "matches" sorted and no longer than "count"
+void FrameIndex::insert( size_t index, float distance, size_t count, vector<Match>* matches ) const
+{
+	if ( matches->size() < count ) {
+		matches->push_back( mPoints[ index ] );
+	} else if ( distance < matches->back().mDistance ) {
+		matches->back() = mPoints[ index ];
+	} else {
+		return;
+	}
+	matches->back().mDistance = distance;
+	for ( size_t i = matches->size() - 1; i > 0 && ( *matches )[ i - 1 ].mDistance > distance; --i ) {
+		swap( ( *matches )[ i - 1 ], ( *matches )[ i ] );
+	}
+}
+
+bool FrameIndex::isTree() const
+{
+	return mTree;
+}
+
+void FrameIndex::searchNearest( size_t begin, size_t end, const Vec3f& position, 
+							   size_t count, vector<Match>* matches ) const
+{
+	if ( begin >= end ) {
+		return;
+	}
+	size_t node		= begin + ( end - begin ) / 2;
+	uint8_t axis	= mAxes[ node ];
+	float x			= mX[ node ] - position.x;
+	float y			= mY[ node ] - position.y;
+	float z			= mZ[ node ] - position.z;
+	insert( node, x * x + y * y + z * z, count, matches );
+
+	// Visit the half containing the position first. The other 
+	// half is only visited if it may hold a nearer point.
+	float delta = position[ axis ] - mPoints[ node ].mPosition[ axis ];
+	if ( delta < 0.0f ) {
+		searchNearest( begin, node, position, count, matches );
+	} else {
+		searchNearest( node + 1, end, position, count, matches );
+	}
+	if ( matches->size() < count || delta * delta < matches->back().mDistance ) {
+		if ( delta < 0.0f ) {
+			searchNearest( node + 1, end, position, count, matches );
+		} else {
+			searchNearest( begin, node, position, count, matches );
+		}
+	}
+}
+
+void FrameIndex::searchRadius( size_t begin, size_t end, const Vec3f& position, 
+							  float radius, vector<Match>* matches ) const
+{
+	if ( begin >= end ) {
+		return;
+	}
+	size_t node		= begin + ( end - begin ) / 2;
+	uint8_t axis	= mAxes[ node ];
+	float x			= mX[ node ] - position.x;
+	float y			= mY[ node ] - position.y;
+	float z			= mZ[ node ] - position.z;
+	float distance	= x * x + y * y + z * z;
+	if ( distance <= radius ) {
+		matches->push_back( mPoints[ node ] );
+		matches->back().mDistance = distance;
+	}
+
+	// "radius" is squared
+	float delta = position[ axis ] - mPoints[ node ].mPosition[ axis ];
+	if ( delta <= 0.0f || delta * delta <= radius ) {
+		searchRadius( begin, node, position, radius, matches );
+	}
+	if ( delta >= 0.0f || delta * delta <= radius ) {
+		searchRadius( node + 1, end, position, radius, matches );
+	}
+}
+
+// Sorts range into a balanced tree, splitting 
+// each node along the range's longest side
+void FrameIndex::split( size_t begin, size_t end )
+{
+	if ( end - begin < 2 ) {
+		return;
+	}
+	Vec3f lower = mPoints[ begin ].mPosition;
+	Vec3f upper = lower;
+	for ( size_t i = begin + 1; i < end; ++i ) {
+		const Vec3f& v = mPoints[ i ].mPosition;
+		lower = Vec3f( math<float>::min( lower.x, v.x ), math<float>::min( lower.y, v.y ), math<float>::min( lower.z, v.z ) );
+		upper = Vec3f( math<float>::max( upper.x, v.x ), math<float>::max( upper.y, v.y ), math<float>::max( upper.z, v.z ) );
+	}
+	Vec3f size		= upper - lower;
+	uint8_t axis	= size.x >= size.y && size.x >= size.z ? 0 : ( size.y >= size.z ? 1 : 2 );
+
+	size_t node = begin + ( end - begin ) / 2;
+	nth_element( mPoints.begin() + begin, mPoints.begin() + node, mPoints.begin() + end, 
+		[ axis ]( const Match& a, const Match& b )
+	{
+		return a.mPosition[ axis ] < b.mPosition[ axis ];
+	} );
+	mAxes[ node ] = axis;
+	split( begin, node );
+	split( node + 1, end );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+PointableTracker::PointableTracker( size_t capacity )
+	: mAccelerationNoise( 5000.0f ), mCapacity( math<size_t>::max( capacity, 1 ) ), 
+	mCoastTime( 250000 ), mFrameId( -1 ), mGateDistance( 40.0f ), mMeasurementNoise( 1.5f ), 
+	mNextId( 0 ), mTimestamp( 0 )
+{
+	mAssigned.reserve( mCapacity );
+	mMeasurements.reserve( mCapacity );
+	mPairs.reserve( mCapacity * mCapacity );
+	mTracks.reserve( mCapacity );
+}
+
+void PointableTracker::add( const Pointable& p, int32_t handId, bool tool )
+{
+	if ( mMeasurements.size() < mCapacity ) {
+		Measurement m;
+		m.mHandId	= handId;
+		m.mId		= p.getId();
+		m.mPosition	= p.getPosition();
+		m.mTool		= tool;
+		m.mTrack	= -1;
+		m.mVelocity	= p.getVelocity();
+		mMeasurements.push_back( m );
+	}
+}
+
+// Corrects the track's prediction with the measured position
+void PointableTracker::assign( uint32_t track, uint32_t measurement )
+{
+	Track& t			= mTracks[ track ];
+	Measurement& m		= mMeasurements[ measurement ];
+	float* p			= t.mCovariance;
+	float s				= p[ 0 ] + mMeasurementNoise * mMeasurementNoise;
+	float k0			= p[ 0 ] / s;
+	float k1			= p[ 1 ] / s;
+	Vec3f innovation	= m.mPosition - t.mPosition;
+	t.mPosition			+= innovation * k0;
+	t.mVelocity			+= innovation * k1;
+	p[ 2 ]				-= k1 * p[ 1 ];
+	p[ 1 ]				*= 1.0f - k0;
+	p[ 0 ]				*= 1.0f - k0;
+
+	t.mHandId			= m.mHandId;
+	t.mMissed			= 0;
+	t.mPointableId		= m.mId;
+	t.mTimestamp		= mTimestamp;
+	m.mTrack			= (int32_t)track;
+	mAssigned[ track ]	= true;
+}
+
+size_t PointableTracker::getCapacity() const
+{
+	return mCapacity;
+}
+
+int64_t PointableTracker::getCoastTime() const
+{
+	return mCoastTime;
+}
+
+float PointableTracker::getGateDistance() const
+{
+	return mGateDistance;
+}
+
+int32_t PointableTracker::getTrackId( int32_t pointableId ) const
+{
+	for ( vector<Track>::const_iterator iter = mTracks.begin(); iter != mTracks.end(); ++iter ) {
+		if ( iter->mPointableId == pointableId && pointableId >= 0 ) {
+			return iter->mId;
+		}
+	}
+	return -1;
+}
+
+const vector<PointableTracker::Track>& PointableTracker::getTracks() const
+{
+	return mTracks;
+}
+
+void PointableTracker::reset()
+{
+	mFrameId = -1;
+	mTracks.clear();
+}
+
+void PointableTracker::setCoastTime( int64_t microseconds )
+{
+	mCoastTime = math<int64_t>::max( microseconds, 0 );
+}
+
+void PointableTracker::setGateDistance( float distance )
+{
+	mGateDistance = math<float>::max( distance, 0.0f );
+}
+
+void PointableTracker::setNoise( float acceleration, float measurement )
+{
+	mAccelerationNoise	= math<float>::max( acceleration, 0.0f );
+	mMeasurementNoise	= math<float>::max( measurement, 0.001f );
+}
+
+void PointableTracker::update( const Frame& frame )
+{
+	if ( frame.getId() == mFrameId && frame.getTimestamp() == mTimestamp ) {
+		return;
+	}
+	float dt	= mFrameId < 0 ? 0.0f : (float)( frame.getTimestamp() - mTimestamp ) * 0.000001f;
+	dt			= math<float>::clamp( dt, 0.0f, 1.0f );
+	mFrameId	= frame.getId();
+	mTimestamp	= frame.getTimestamp();
+
+	mMeasurements.clear();
+	const HandMap& hands = frame.getHands();
+	for ( HandMap::const_iterator handIter = hands.begin(); handIter != hands.end(); ++handIter ) {
+		const FingerMap& fingers = handIter->second.getFingers();
+		for ( FingerMap::const_iterator iter = fingers.begin(); iter != fingers.end(); ++iter ) {
+			add( iter->second, handIter->first, false );
+		}
+		const ToolMap& tools = handIter->second.getTools();
+		for ( ToolMap::const_iterator iter = tools.begin(); iter != tools.end(); ++iter ) {
+			add( iter->second, handIter->first, true );
+		}
+	}
+
+	// Predict each track forward to this frame
+	float q = mAccelerationNoise * mAccelerationNoise;
+	for ( vector<Track>::iterator iter = mTracks.begin(); iter != mTracks.end(); ++iter ) {
+		float* p		= iter->mCovariance;
+		iter->mPosition	+= iter->mVelocity * dt;
+		p[ 0 ]			+= dt * ( 2.0f * p[ 1 ] + dt * p[ 2 ] ) + q * dt * dt * dt * dt * 0.25f;
+		p[ 1 ]			+= dt * p[ 2 ] + q * dt * dt * dt * 0.5f;
+		p[ 2 ]			+= q * dt * dt;
+	}
+	mAssigned.assign( mTracks.size(), false );
+
+	// Pointables keep their track while Leap keeps their ID
+	float gate = mGateDistance * mGateDistance;
+	for ( uint32_t i = 0; i < mMeasurements.size(); ++i ) {
+		const Measurement& m = mMeasurements[ i ];
+		for ( uint32_t j = 0; j < mTracks.size(); ++j ) {
+			const Track& t = mTracks[ j ];
+			if ( !mAssigned[ j ] && t.mPointableId == m.mId && t.mTool == m.mTool && 
+				t.mPosition.distanceSquared( m.mPosition ) <= gate ) {
+				assign( j, i );
+				break;
+			}
+		}
+	}
+
+	// Then the closest remaining pairs within the gate
+	mPairs.clear();
+	for ( uint32_t i = 0; i < mMeasurements.size(); ++i ) {
+		const Measurement& m = mMeasurements[ i ];
+		for ( uint32_t j = 0; m.mTrack < 0 && j < mTracks.size(); ++j ) {
+			if ( mAssigned[ j ] || mTracks[ j ].mTool != m.mTool ) {
+				continue;
+			}
+			float distance = mTracks[ j ].mPosition.distanceSquared( m.mPosition );
+			if ( distance <= gate ) {
+				Pair pair;
+				pair.mDistance		= distance;
+				pair.mMeasurement	= i;
+				pair.mTrack			= j;
+				mPairs.push_back( pair );
+			}
+		}
+	}
+	sort( mPairs.begin(), mPairs.end(), []( const Pair& a, const Pair& b )
+	{
+		return a.mDistance < b.mDistance;
+	} );
+	for ( vector<Pair>::const_iterator iter = mPairs.begin(); iter != mPairs.end(); ++iter ) {
+		if ( !mAssigned[ iter->mTrack ] && mMeasurements[ iter->mMeasurement ].mTrack < 0 ) {
+			assign( iter->mTrack, iter->mMeasurement );
+		}
+	}
+
+	// Unmatched tracks coast until they expire
+	for ( size_t i = 0; i < mTracks.size(); ) {
+		Track& t = mTracks[ i ];
+		if ( !mAssigned[ i ] ) {
+			t.mPointableId = -1;
+			++t.mMissed;
+			if ( mTimestamp - t.mTimestamp > mCoastTime ) {
+				t				= mTracks.back();
+				mAssigned[ i ]	= mAssigned.back();
+				mTracks.pop_back();
+				mAssigned.pop_back();
+				continue;
+			}
+		}
+		++i;
+	}
+
+	// Pointables left over start new tracks. Leap's velocity 
+	// is trusted to within 100mm/s to start with.
+	for ( vector<Measurement>::const_iterator iter = mMeasurements.begin(); iter != mMeasurements.end(); ++iter ) {
+		if ( iter->mTrack >= 0 || mTracks.size() >= mCapacity ) {
+			continue;
+		}
+		Track t;
+		t.mCovariance[ 0 ]	= mMeasurementNoise * mMeasurementNoise;
+		t.mCovariance[ 1 ]	= 0.0f;
+		t.mCovariance[ 2 ]	= 10000.0f;
+		t.mHandId			= iter->mHandId;
+		t.mId				= mNextId++;
+		t.mMissed			= 0;
+		t.mPointableId		= iter->mId;
+		t.mPosition			= iter->mPosition;
+		t.mTimestamp		= mTimestamp;
+		t.mTool				= iter->mTool;
+		t.mVelocity			= iter->mVelocity;
+		mTracks.push_back( t );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+HandDescriptor::HandDescriptor()
+	: mHandId( -1 )
+{
+	memset( mValues, 0, sizeof( mValues ) );
+}
+
+HandDescriptor::HandDescriptor( const Hand& hand )
+{
+	set( hand );
+}
+
+size_t HandDescriptor::create( const Frame& frame, HandDescriptor* descriptors, size_t count )
+{
+	size_t i = 0;
+	const HandMap& hands = frame.getHands();
+	for ( HandMap::const_iterator iter = hands.begin(); iter != hands.end() && i < count; ++iter, ++i ) {
+		descriptors[ i ].set( iter->second );
+	}
+	return i;
+}
+
+float HandDescriptor::distanceSquared( const HandDescriptor& d ) const
+{
+	float distance = 0.0f;
+	for ( size_t i = 0; i < SIZE; ++i ) {
+		float delta	= mValues[ i ] - d.mValues[ i ];
+		distance	+= delta * delta;
+	}
+	return distance;
+}
+
+void HandDescriptor::set( const Hand& hand )
+{
+	memset( mValues, 0, sizeof( mValues ) );
+	mHandId = hand.getId();
+
+	// Palm space has x across the palm, y out of the back 
+	// of the hand, and fingers pointing down -z
+	Vec3f z = -hand.getDirection().safeNormalized();
+	Vec3f y = -hand.getNormal().safeNormalized();
+	Vec3f x = y.cross( z ).safeNormalized();
+	const Vec3f& palm			= hand.getPosition();
+	const Vec3f& palmVelocity	= hand.getVelocity();
+
+	// Sort fingers across the palm
+	size_t count = 0;
+	Vec3f directions[ MAX_FINGERS ];
+	Vec3f positions[ MAX_FINGERS ];
+	float speeds[ MAX_FINGERS ];
+	const FingerMap& fingers = hand.getFingers();
+	for ( FingerMap::const_iterator iter = fingers.begin(); iter != fingers.end() && count < MAX_FINGERS; ++iter ) {
+		const Finger& finger	= iter->second;
+		Vec3f v					= finger.getPosition() - palm;
+		Vec3f position( v.dot( x ), v.dot( y ), v.dot( z ) );
+		Vec3f direction			= finger.getDirection();
+		float speed				= ( finger.getVelocity() - palmVelocity ).length();
+		size_t i				= count++;
+		for ( ; i > 0 && positions[ i - 1 ].x > position.x; --i ) {
+			directions[ i ]	= directions[ i - 1 ];
+			positions[ i ]	= positions[ i - 1 ];
+			speeds[ i ]		= speeds[ i - 1 ];
+		}
+		directions[ i ]	= direction;
+		positions[ i ]	= position;
+		speeds[ i ]		= speed;
+	}
+
+	float fingerSpeed = 0.0f;
 	for ( size_t i = 0; i < count; ++i ) {
-		mScreens[ i ] = Screen( screens[ i ] );
+		float* v	= mValues + FINGER_POSITIONS + i * 3;
+		v[ 0 ]		= positions[ i ].x * 0.01f;
+		v[ 1 ]		= positions[ i ].y * 0.01f;
+		v[ 2 ]		= positions[ i ].z * 0.01f;
+		mValues[ FINGER_SPEEDS + i ] = speeds[ i ] * 0.001f;
+		fingerSpeed	+= speeds[ i ];
+		if ( i > 0 ) {
+			float cosine = math<float>::clamp( directions[ i - 1 ].safeNormalized().dot( directions[ i ].safeNormalized() ), -1.0f, 1.0f );
+			mValues[ FINGER_ANGLES + i - 1 ] = math<float>::acos( cosine ) / (float)M_PI;
+		}
+	}
+	
+	mValues[ FINGER_COUNT ]		= (float)count / (float)MAX_FINGERS;
+	mValues[ SPHERE_RADIUS ]	= hand.getSphereRadius() * 0.01f;
+	mValues[ PALM_SPEED ]		= palmVelocity.length() * 0.001f;
+	mValues[ FINGER_SPEED ]		= count > 0 ? fingerSpeed / (float)count * 0.001f : 0.0f;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Pose models start with "LPOS", a version, the descriptor size and the 
+// number of examples. Each example is a pose ID and its descriptor values.
+// Everything is 32 bits wide and little-endian.
+static const uint32_t kPoseModelMagic	= 0x534f504c;
+static const uint32_t kPoseModelVersion	= 1;
+
+static void writeUint32( uint32_t v, vector<uint8_t>* buffer )
+{
+	for ( size_t i = 0; i < 4; ++i ) {
+		buffer->push_back( (uint8_t)( ( v >> ( i * 8 ) ) & 0xff ) );
+	}
+}
+
+static uint32_t readUint32( const uint8_t* data )
+{
+	return (uint32_t)data[ 0 ] | ( (uint32_t)data[ 1 ] << 8 ) | ( (uint32_t)data[ 2 ] << 16 ) | ( (uint32_t)data[ 3 ] << 24 );
+}
+
+PoseClassifier::PoseClassifier( size_t k )
+	: mK( math<size_t>::clamp( k, 1, (size_t)MAX_K ) ), mMaxDistance( 1.5f )
+{
+	loadDefault();
+}
+
+// Adds examples of a built-in pose at several hand sizes. Fingertips 
+// and the directions fingers point in are in palm space, ordered across 
+// the palm, with tips in millimeters. Angles are taken between 
+// directions, as HandDescriptor::set() does.
+void PoseClassifier::addDefault( int32_t pose, float sphereRadius, const Vec3f* tips, 
+								 const Vec3f* directions, size_t count )
+{
+	static const float scales[] = { 0.8f, 0.9f, 1.0f, 1.1f, 1.2f };
+	for ( size_t i = 0; i < sizeof( scales ) / sizeof( scales[ 0 ] ); ++i ) {
+		HandDescriptor d;
+		d.mValues[ HandDescriptor::FINGER_COUNT ]	= (float)count / (float)HandDescriptor::MAX_FINGERS;
+		d.mValues[ HandDescriptor::SPHERE_RADIUS ]	= sphereRadius * scales[ i ] * 0.01f;
+		for ( size_t j = 0; j < count; ++j ) {
+			Vec3f tip	= tips[ j ] * scales[ i ] * 0.01f;
+			float* v	= d.mValues + HandDescriptor::FINGER_POSITIONS + j * 3;
+			v[ 0 ]		= tip.x;
+			v[ 1 ]		= tip.y;
+			v[ 2 ]		= tip.z;
+			if ( j > 0 ) {
+				float cosine = math<float>::clamp( directions[ j - 1 ].safeNormalized().dot( directions[ j ].safeNormalized() ), -1.0f, 1.0f );
+				d.mValues[ HandDescriptor::FINGER_ANGLES + j - 1 ] = math<float>::acos( cosine ) / (float)M_PI;
+			}
+		}
+		addExample( pose, d );
+	}
+}
+
+void PoseClassifier::addExample( int32_t pose, const HandDescriptor& descriptor )
+{
+	Example example;
+	example.mDescriptor	= descriptor;
+	example.mPose		= pose;
+	mExamples.push_back( example );
+}
+
+void PoseClassifier::clear()
+{
+	mExamples.clear();
+}
+
+PoseClassifier::Result PoseClassifier::classify( const HandDescriptor& descriptor ) const
+{
+	Result result;
+	result.mConfidence	= 0.0f;
+	result.mDistance	= numeric_limits<float>::max();
+	result.mHandId		= descriptor.mHandId;
+	result.mPose		= POSE_UNKNOWN;
+
+	// Find nearest examples, keeping squared distances in order
+	size_t count = 0;
+	float distances[ MAX_K ];
+	int32_t poses[ MAX_K ];
+	for ( vector<Example>::const_iterator iter = mExamples.begin(); iter != mExamples.end(); ++iter ) {
+		float distance = descriptor.distanceSquared( iter->mDescriptor );
+		if ( count == mK && distance >= distances[ count - 1 ] ) {
+			continue;
+		}
+		size_t i = count < mK ? count++ : count - 1;
+		for ( ; i > 0 && distances[ i - 1 ] > distance; --i ) {
+			distances[ i ]	= distances[ i - 1 ];
+			poses[ i ]		= poses[ i - 1 ];
+		}
+		distances[ i ]	= distance;
+		poses[ i ]		= iter->mPose;
+	}
+	if ( count == 0 ) {
+		return result;
+	}
+	result.mDistance = math<float>::sqrt( distances[ 0 ] );
+	if ( result.mDistance > mMaxDistance ) {
+		return result;
+	}
+
+	// Nearer examples carry more weight
+	float total = 0.0f;
+	float weights[ MAX_K ];
+	for ( size_t i = 0; i < count; ++i ) {
+		weights[ i ]	= 1.0f / ( math<float>::sqrt( distances[ i ] ) + 0.01f );
+		total			+= weights[ i ];
+	}
+	float best = 0.0f;
+	for ( size_t i = 0; i < count; ++i ) {
+		float weight = 0.0f;
+		for ( size_t j = 0; j < count; ++j ) {
+			weight += poses[ j ] == poses[ i ] ? weights[ j ] : 0.0f;
+		}
+		if ( weight > best ) {
+			best			= weight;
+			result.mPose	= poses[ i ];
+		}
+	}
+	result.mConfidence = best / total;
+	return result;
+}
+
+size_t PoseClassifier::classify( const Frame& frame, Result* results, size_t count ) const
+{
+	size_t i = 0;
+	const HandMap& hands = frame.getHands();
+	for ( HandMap::const_iterator iter = hands.begin(); iter != hands.end() && i < count; ++iter, ++i ) {
+		results[ i ] = classify( HandDescriptor( iter->second ) );
+	}
+	return i;
+}
+
+size_t PoseClassifier::getExampleCount() const
+{
+	return mExamples.size();
+}
+
+size_t PoseClassifier::getK() const
+{
+	return mK;
+}
+
+float PoseClassifier::getMaxDistance() const
+{
+	return mMaxDistance;
+}
+
+bool PoseClassifier::load( const void* data, size_t size )
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	if ( bytes == 0 || size < 16 || 
+		readUint32( bytes ) != kPoseModelMagic || 
+		readUint32( bytes + 4 ) != kPoseModelVersion || 
+		readUint32( bytes + 8 ) != (uint32_t)HandDescriptor::SIZE ) {
+		return false;
 	}
+	size_t count		= readUint32( bytes + 12 );
+	size_t exampleSize	= 4 + HandDescriptor::SIZE * 4;
+	if ( count > ( size - 16 ) / exampleSize || size != 16 + count * exampleSize ) {
+		return false;
+	}
+
+	vector<Example> examples( count );
+	const uint8_t* v = bytes + 16;
+	for ( size_t i = 0; i < count; ++i ) {
+		examples[ i ].mPose = (int32_t)readUint32( v );
+		v += 4;
+		for ( size_t j = 0; j < HandDescriptor::SIZE; ++j ) {
+			uint32_t value = readUint32( v );
+			memcpy( &examples[ i ].mDescriptor.mValues[ j ], &value, 4 );
+			v += 4;
+		}
+	}
+	mExamples.swap( examples );
+	return true;
+}
+
+bool PoseClassifier::load( DataSourceRef source )
+{
+	if ( !source ) {
+		return false;
+	}
+	Buffer& buffer = source->getBuffer();
+	return load( buffer.getData(), buffer.getDataSize() );
+}
+
+void PoseClassifier::loadDefault()
+{
+	mExamples.clear();
+
+	static const Vec3f open[] = {
+		Vec3f( -60.0f, -5.0f, -40.0f ), Vec3f( -30.0f, 0.0f, -90.0f ), Vec3f( 0.0f, 0.0f, -100.0f ), 
+		Vec3f( 25.0f, 0.0f, -95.0f ), Vec3f( 50.0f, -5.0f, -75.0f )
+	};
+	static const Vec3f openDirections[] = {
+		Vec3f( -0.7f, 0.0f, -0.7f ), Vec3f( -0.25f, 0.0f, -1.0f ), Vec3f( 0.0f, 0.0f, -1.0f ), 
+		Vec3f( 0.2f, 0.0f, -1.0f ), Vec3f( 0.4f, -0.05f, -1.0f )
+	};
+	static const Vec3f point[]				= { Vec3f( -15.0f, 0.0f, -95.0f ) };
+	static const Vec3f pointDirections[]	= { Vec3f( -0.1f, 0.0f, -1.0f ) };
+	// Thumb and index finger bend down and in to meet
+	static const Vec3f pinch[]				= { Vec3f( -30.0f, -20.0f, -55.0f ), Vec3f( -15.0f, -20.0f, -60.0f ) };
+	static const Vec3f pinchDirections[]	= { Vec3f( 0.5f, -0.4f, -0.75f ), Vec3f( -0.3f, -0.6f, -0.75f ) };
+	addDefault( POSE_OPEN_HAND,	120.0f,	open,	openDirections,		5 );
+	addDefault( POSE_FIST,		45.0f,	0,		0,					0 );
+	addDefault( POSE_POINT,		70.0f,	point,	pointDirections,	1 );
+	addDefault( POSE_PINCH,		55.0f,	pinch,	pinchDirections,	2 );
+}
+
+void PoseClassifier::save( vector<uint8_t>* buffer ) const
+{
+	writeUint32( kPoseModelMagic, buffer );
+	writeUint32( kPoseModelVersion, buffer );
+	writeUint32( (uint32_t)HandDescriptor::SIZE, buffer );
+	writeUint32( (uint32_t)mExamples.size(), buffer );
+	for ( vector<Example>::const_iterator iter = mExamples.begin(); iter != mExamples.end(); ++iter ) {
+		writeUint32( (uint32_t)iter->mPose, buffer );
+		for ( size_t i = 0; i < HandDescriptor::SIZE; ++i ) {
+			uint32_t value = 0;
+			memcpy( &value, &iter->mDescriptor.mValues[ i ], 4 );
+			writeUint32( value, buffer );
+		}
+	}
+}
+
+void PoseClassifier::setK( size_t k )
+{
+	mK = math<size_t>::clamp( k, 1, (size_t)MAX_K );
+}
+
+void PoseClassifier::setMaxDistance( float distance )
+{
+	mMaxDistance = math<float>::max( distance, 0.0f );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+ConfigSnapshot::ConfigSnapshot()
+{
+	for ( size_t i = 0; i < kConfigKeyCount; ++i ) {
+		this->*kConfigKeys[ i ].mValue = kConfigKeys[ i ].mDefault;
+	}
+}
+
+bool ConfigSnapshot::load( const string& text )
+{
+	ConfigSnapshot config = *this;
+	istringstream stream( text );
+	string line;
+	while ( getline( stream, line ) ) {
+		size_t first = line.find_first_not_of( " \t\r" );
+		if ( first == string::npos || line[ first ] == '#' ) {
+			continue;
+		}
+		size_t equals = line.find( '=', first );
+		if ( equals == string::npos ) {
+			return false;
+		}
+		size_t last = line.find_last_not_of( " \t", equals - 1 );
+		string name = line.substr( first, last - first + 1 );
+		for ( size_t i = 0; i < kConfigKeyCount; ++i ) {
+			if ( name == kConfigKeys[ i ].mName ) {
+				const char* value	= line.c_str() + equals + 1;
+				char* end			= 0;
+				float v				= (float)strtod( value, &end );
+				if ( end == value || string( end ).find_first_not_of( " \t\r" ) != string::npos ) {
+					return false;
+				}
+				config.*kConfigKeys[ i ].mValue = v;
+				break;
+			}
+		}
+	}
+	*this = config;
+	return true;
+}
+
+bool ConfigSnapshot::load( DataSourceRef source )
+{
+	if ( !source ) {
+		return false;
+	}
+	Buffer& buffer = source->getBuffer();
+	return load( string( (const char*)buffer.getData(), buffer.getDataSize() ) );
+}
+
+void ConfigSnapshot::save( string* text ) const
+{
+	ostringstream stream;
+	stream << setprecision( 9 );
+	for ( size_t i = 0; i < kConfigKeyCount; ++i ) {
+		stream << kConfigKeys[ i ].mName << " = " << this->*kConfigKeys[ i ].mValue << "\n";
+	}
+	*text = stream.str();
+}
+
+bool ConfigSnapshot::operator==( const ConfigSnapshot& rhs ) const
+{
+	for ( size_t i = 0; i < kConfigKeyCount; ++i ) {
+		if ( this->*kConfigKeys[ i ].mValue != rhs.*kConfigKeys[ i ].mValue ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ConfigSnapshot::operator!=( const ConfigSnapshot& rhs ) const
+{
+	return !( *this == rhs );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+double DeviceStats::CallbackStats::getAverageTime() const
+{
+	return mCalls == 0 ? 0.0 : (double)mTime / (double)mCalls;
+}
+
+DeviceStats::DeviceStats()
+	: mFramesDelivered( 0 ), mFramesDropped( 0 ), mFramesReceived( 0 ), mFrameRate( 0.0f ), 
+	mHandCount( 0 ), mLockCount( 0 ), mLockMaxWaitTime( 0 ), mLockWaitTime( 0 ), mPointableCount( 0 )
+{
+}
+
+double DeviceStats::getAverageHands() const
+{
+	return mFramesDelivered == 0 ? 0.0 : (double)mHandCount / (double)mFramesDelivered;
+}
+
+double DeviceStats::getAverageLockWaitTime() const
+{
+	return mLockCount == 0 ? 0.0 : (double)mLockWaitTime / (double)mLockCount;
+}
+
+double DeviceStats::getAveragePointables() const
+{
+	return mFramesDelivered == 0 ? 0.0 : (double)mPointableCount / (double)mFramesDelivered;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint64_t getClockMicroseconds()
+{
+	return (uint64_t)chrono::duration_cast<chrono::microseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+// A source clock that jumps this many microseconds has restarted
+static const int64_t kClockJumpTime = 1000000;
+
+// Updates \a offset from a frame's timestamp to the host clock. The 
+// smallest offset seen belongs to the frame with the least delivery 
+// delay. It creeps up a microsecond per frame to follow clock drift, 
+// and restarts when the source's clock jumps, e.g., when the tracker 
+// restarts or a recording loops.
+static void alignClock( int64_t clock, int64_t timestamp, bool first, int64_t* offset )
+{
+	int64_t current = clock - timestamp;
+	if ( first || current < *offset || current - *offset > kClockJumpTime ) {
+		*offset = current;
+	} else {
+		++*offset;
+	}
+}
+
+// Raises a statistic to at least value without taking a lock
+static void storeMax( atomic<int64_t>& statistic, int64_t value )
+{
+	int64_t current = statistic.load( memory_order_relaxed );
+	while ( value > current && !statistic.compare_exchange_weak( current, value, memory_order_relaxed ) ) {
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Spans buffered per thread between flushes
+static const size_t kTraceBufferSize	= 2048;
+// Threads which may trace at once. The block's threads release their 
+// buffers when they exit, and others keep theirs until the next trace.
+static const size_t kTraceThreadCount	= 32;
+// Time between writes to the trace file, in milliseconds
+static const int32_t kTraceFlushTime	= 100;
+
+struct TraceEvent
+{
+	int64_t		mArgument;
+	int64_t		mDuration;
+	const char*	mName;
+	int64_t		mStart;
+	uint32_t	mTid;
+};
+
+struct TraceThread
+{
+	// Hash of the owning thread's ID, or zero while unclaimed
+	atomic<size_t>							mOwner;
+	RingBuffer<TraceEvent, kTraceBufferSize>	mEvents;
+	// Thread ID written to the file, set by each thread claiming the 
+	// buffer so each thread has its own track
+	uint32_t								mTid;
+};
+
+// Buffers are allocated by the first trace and kept, so that a span 
+// finishing while tracing stops never writes to freed memory
+struct TraceState
+{
+	atomic<uint64_t>		mDropped;
+	ofstream				mFile;
+	bool					mFirstEvent;
+	atomic<uint32_t>		mNextTid;
+	atomic<bool>			mRunning;
+	shared_ptr<thread>		mThread;
+	TraceThread				mThreads[ kTraceThreadCount ];
+};
+
+static atomic<bool>		sTraceEnabled( false );
+static mutex			sTraceMutex;
+static TraceState*		sTraceState = 0;
+// Spans being written to a buffer, counted only while tracing
+static atomic<int32_t>	sTraceWriters( 0 );
+
+// Returns the calling thread's buffer owner ID
+static size_t getTraceOwner()
+{
+	return hash<thread::id>()( this_thread::get_id() ) | 1;
+}
+
+// Finds or claims the calling thread's buffer without locking
+static TraceThread* getTraceThread()
+{
+	size_t owner = getTraceOwner();
+	for ( size_t i = 0; i < kTraceThreadCount; ++i ) {
+		TraceThread& traceThread	= sTraceState->mThreads[ i ];
+		size_t current				= traceThread.mOwner.load( memory_order_acquire );
+		if ( current == owner ) {
+			return &traceThread;
+		} else if ( current == 0 && traceThread.mOwner.compare_exchange_strong( current, owner ) ) {
+			traceThread.mTid = sTraceState->mNextTid.fetch_add( 1 ) + 1;
+			return &traceThread;
+		}
+	}
+	return 0;
+}
+
+// Releases the buffer claimed by \a owner, whose thread has exited or 
+// will not trace again. Spans it holds are still written, since only 
+// one thread at a time owns the buffer and each span keeps its ID.
+static void releaseTraceThread( size_t owner )
+{
+	if ( owner == 0 || !sTraceEnabled.load() ) {
+		return;
+	}
+	for ( size_t i = 0; i < kTraceThreadCount; ++i ) {
+		size_t current = owner;
+		if ( sTraceState->mThreads[ i ].mOwner.compare_exchange_strong( current, 0 ) ) {
+			return;
+		}
+	}
+}
+
+// Writes buffered spans to the file. Without a file, spans are discarded.
+static void flushTrace( TraceState* state )
+{
+	for ( size_t i = 0; i < kTraceThreadCount; ++i ) {
+		TraceEvent event;
+		while ( state->mThreads[ i ].mEvents.pop( &event ) ) {
+			if ( !state->mFile.is_open() ) {
+				continue;
+			}
+			state->mFile << ( state->mFirstEvent ? "\n" : ",\n" );
+			state->mFile << "{\"name\":\"" << event.mName << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.mTid 
+				<< ",\"ts\":" << event.mStart << ",\"dur\":" << event.mDuration;
+			if ( event.mArgument >= 0 ) {
+				state->mFile << ",\"args\":{\"id\":" << event.mArgument << "}";
+			}
+			state->mFile << "}";
+			state->mFirstEvent = false;
+		}
+	}
+	if ( state->mFile.is_open() ) {
+		state->mFile.flush();
+	}
+}
+
+static void runTrace( TraceState* state )
+{
+	while ( state->mRunning ) {
+		this_thread::sleep_for( chrono::milliseconds( kTraceFlushTime ) );
+		flushTrace( state );
+	}
+}
+
+uint64_t Tracer::getEventsDropped()
+{
+	lock_guard<mutex> lock( sTraceMutex );
+	return sTraceState == 0 ? 0 : sTraceState->mDropped.load( memory_order_relaxed );
+}
+
+bool Tracer::isEnabled()
+{
+	return sTraceEnabled.load( memory_order_relaxed );
+}
+
+bool Tracer::start( const string& path )
+{
+	stop();
+
+	lock_guard<mutex> lock( sTraceMutex );
+	if ( sTraceState == 0 ) {
+		sTraceState = new TraceState();
+		for ( size_t i = 0; i < kTraceThreadCount; ++i ) {
+			sTraceState->mThreads[ i ].mOwner	= 0;
+			sTraceState->mThreads[ i ].mTid		= 0;
+		}
+		sTraceState->mRunning = false;
+	}
+
+	// Release all buffers. Spans which passed the enabled check before 
+	// the last trace stopped may still be writing to theirs, so wait 
+	// for them. Spans they wrote are discarded.
+	while ( sTraceWriters.load() > 0 ) {
+		this_thread::yield();
+	}
+	flushTrace( sTraceState );
+	for ( size_t i = 0; i < kTraceThreadCount; ++i ) {
+		sTraceState->mThreads[ i ].mOwner = 0;
+	}
+
+	sTraceState->mFile.open( path.c_str(), ios::out | ios::trunc );
+	if ( !sTraceState->mFile.is_open() ) {
+		return false;
+	}
+	sTraceState->mFile << "[";
+	sTraceState->mDropped		= 0;
+	sTraceState->mFirstEvent	= true;
+	sTraceState->mNextTid		= 0;
+	sTraceState->mRunning		= true;
+	sTraceState->mThread		= shared_ptr<thread>( new thread( &runTrace, sTraceState ) );
+	sTraceEnabled				= true;
+	return true;
+}
+
+void Tracer::stop()
+{
+	lock_guard<mutex> lock( sTraceMutex );
+	if ( sTraceState == 0 || !sTraceState->mRunning ) {
+		return;
+	}
+	sTraceEnabled			= false;
+	sTraceState->mRunning	= false;
+	sTraceState->mThread->join();
+	sTraceState->mThread.reset();
+
+	// Record lost spans as a counter, so a trace with gaps says so
+	flushTrace( sTraceState );
+	sTraceState->mFile << ( sTraceState->mFirstEvent ? "\n" : ",\n" );
+	sTraceState->mFile << "{\"name\":\"Spans dropped\",\"ph\":\"C\",\"pid\":1,\"ts\":" << getClockMicroseconds() 
+		<< ",\"args\":{\"count\":" << sTraceState->mDropped.load() << "}}";
+	sTraceState->mFile << "\n]\n";
+	sTraceState->mFile.close();
+}
+
+TraceSpan::TraceSpan( const char* name, int64_t argument )
+	: mArgument( argument ), mName( name ), mStart( -1 )
+{
+	if ( sTraceEnabled.load( memory_order_relaxed ) ) {
+		mStart = (int64_t)getClockMicroseconds();
+	}
+}
+
+TraceSpan::~TraceSpan()
+{
+	if ( mStart < 0 ) {
+		return;
+	}
+
+	// Counted before checking, so Tracer::start() either sees this 
+	// span writing or this span sees tracing stopped
+	sTraceWriters.fetch_add( 1 );
+	if ( sTraceEnabled.load() ) {
+		TraceEvent event;
+		event.mArgument	= mArgument;
+		event.mDuration	= (int64_t)getClockMicroseconds() - mStart;
+		event.mName		= mName;
+		event.mStart	= mStart;
+
+		TraceThread* traceThread = getTraceThread();
+		if ( traceThread != 0 ) {
+			event.mTid = traceThread->mTid;
+		}
+		if ( traceThread == 0 || !traceThread->mEvents.push( event ) ) {
+			sTraceState->mDropped.fetch_add( 1, memory_order_relaxed );
+		}
+	}
+	sTraceWriters.fetch_sub( 1 );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+Listener::Listener()
+{
+	mCondition			= 0;
+	mDevice				= 0;
+	mFirstFrameReceived	= false;
+	mFrameTime			= 0;
+	mInitialized		= false;
+	mNewFrame			= false;
+	mPipelined			= false;
+	mState				= Device::STATE_INITIALIZING;
+	mTraceOwner			= 0;
+}
+
+void Listener::onConnect( const Leap::Controller& controller ) 
+{
+	mDevice->mConfigPending = true;
+	setState( Device::STATE_CONNECTED );
+}
+
+void Listener::onDisconnect( const Leap::Controller& controller ) 
+{
+	setState( Device::STATE_DISCONNECTED );
+}
+	
+void Listener::onExit( const Leap::Controller& controller )
+{
+	setState( Device::STATE_EXITED );
+}
+
+void Listener::onFrame( const Leap::Controller& controller ) 
+{
+	TraceSpan span( "Listener::onFrame" );
+	mTraceOwner.store( getTraceOwner(), memory_order_relaxed );
+
+	// Resume streaming on the first frame after connecting or stalling
+	mDevice->mFramesReceived.fetch_add( 1, memory_order_relaxed );
+	mFrameTime.store( (int64_t)getClockMicroseconds(), memory_order_relaxed );
+	int32_t state = mState.load();
+	if ( ( state == Device::STATE_CONNECTED || state == Device::STATE_STALLED ) && 
+		mState.compare_exchange_strong( state, Device::STATE_STREAMING ) ) {
+		mTransitions.push( Device::STATE_STREAMING );
+	}
+
+	// Hand the native frame to the worker thread. The frame is 
+	// dropped if the worker has fallen four frames behind.
+	if ( mPipelined ) {
+		Leap::Frame frame = controller.frame();
+		bool pushed;
+		{
+			lock_guard<mutex> lock( mDevice->mThreadMutex );
+			pushed = mPendingFrames.push( frame );
+		}
+		if ( !pushed ) {
+			mDevice->mFramesDropped.fetch_add( 1, memory_order_relaxed );
+		}
+		mCondition->notify_one();
+		return;
+	}
+
+	// Convert every frame when tracking or worker callbacks are 
+	// listening, or frames are recorded for interpolation. Otherwise, 
+	// only convert what update() will deliver.
+	bool dispatching	= mDevice->isDispatching();
+	bool recording		= mDevice->mRecording;
+	Frame frame;
+	{
+		// update() has not taken the last frame, so this one is 
+		// dropped. It is still converted for other listeners.
+		lock_guard<mutex> lock( *mMutex );
+		if ( mNewFrame ) {
+			mDevice->mFramesDropped.fetch_add( 1, memory_order_relaxed );
+			if ( !dispatching && !recording ) {
+				return;
+			}
+		}
+		frame = Frame( controller.frame(), recording ? (uint32_t)Frame::FIELD_ALL : mDevice->getFields() );
+		if ( !mNewFrame ) {
+			mFrame = frame;
+			if ( !mFirstFrameReceived ) {
+				mFirstFrame			= mFrame;
+				mFirstFrameReceived	= true;
+			}
+			mNewFrame	= true;
+		}
+	}
+	if ( recording ) {
+		mDevice->record( frame );
+	}
+	if ( dispatching ) {
+		mDevice->dispatch( frame );
+	}
+}
+
+void Listener::onInit( const Leap::Controller& controller ) 
+{
+	mInitialized = true;
+}
+
+void Listener::setState( int32_t state )
+{
+	mState = state;
+	mTransitions.push( state );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Microseconds behind the current time that getInterpolatedFrame() 
+// samples by default, a little more than one frame period at 
+// typical tracking rates
+static const int64_t kInterpolationDelay = 15000;
+
+DeviceRef Device::create( bool pipelined )
+{
+	return DeviceRef( new Device( pipelined ) );
+}
+
+Device::Device( bool pipelined )
+{
+	mConfigPending			= true;
+	mFields					= 0;
+	mLastDeliveredId		= 0;
+	mLastDeliveredTimestamp	= 0;
+	resetStats();
+	mNotifiedState			= STATE_INITIALIZING;
+	mStallTime				= 250000;
+	mDispatchRunning		= false;
+	mHistoryCount			= 0;
+	mHistoryOffset			= 0;
+	mRecording				= false;
+	mListener.mCondition	= &mCondition;
+	mListener.mDevice		= this;
+	mListener.mMutex		= &mMutex;
+	mListener.mPipelined	= pipelined;
+	mRunning				= pipelined;
+	if ( pipelined ) {
+		mThread = shared_ptr<thread>( new thread( &Device::process, this ) );
+	}
+	mController				= new Leap::Controller( mListener );
+}
+
+Device::~Device()
+{
+	mController->removeListener( mListener );
+	if ( mThread ) {
+		{
+			lock_guard<mutex> lock( mThreadMutex );
+			mRunning = false;
+		}
+		mCondition.notify_one();
+		mThread->join();
+		mThread.reset();
+	}
+	if ( mDispatchThread ) {
+		{
+			lock_guard<mutex> lock( mDispatchMutex );
+			mDispatchRunning = false;
+		}
+		mDispatchCondition.notify_one();
+		mDispatchThread->join();
+		mDispatchThread.reset();
+	}
+
+	// Closes the connection to the Leap service. Nothing else 
+	// touches the controller once the threads have stopped.
+	delete mController;
+	mController = 0;
+	releaseTraceThread( mListener.mTraceOwner );
+	
+	for ( CallbackList::const_iterator iter = mCallbacks.begin(); iter != mCallbacks.end(); ++iter ) {
+		iter->second->disconnect();
+	}
+	mCallbacks.clear();
+
+	lock_guard<mutex> lock( mStatsMutex );
+	mCallbackCounters.clear();
+}
+
+void Device::deliver( const Frame& frame )
+{
+	// Frame IDs count every tracking frame, so the rate holds 
+	// even when frames are dropped between deliveries
+	int64_t id			= frame.getId();
+	int64_t timestamp	= frame.getTimestamp();
+	if ( mLastDeliveredTimestamp > 0 && id > mLastDeliveredId && timestamp > mLastDeliveredTimestamp ) {
+		float rate		= (float)( (double)( id - mLastDeliveredId ) * 1000000.0 / (double)( timestamp - mLastDeliveredTimestamp ) );
+		float average	= mFrameRate.load( memory_order_relaxed );
+		mFrameRate.store( average <= 0.0f ? rate : average + ( rate - average ) * 0.1f, memory_order_relaxed );
+	}
+	mLastDeliveredId		= id;
+	mLastDeliveredTimestamp	= timestamp;
+
+	const HandMap& hands = frame.getHands();
+	uint64_t pointableCount = 0;
+	for ( HandMap::const_iterator iter = hands.begin(); iter != hands.end(); ++iter ) {
+		pointableCount += iter->second.getFingers().size() + iter->second.getTools().size();
+	}
+	mFramesDelivered.fetch_add( 1, memory_order_relaxed );
+	mHandCount.fetch_add( hands.size(), memory_order_relaxed );
+	mPointableCount.fetch_add( pointableCount, memory_order_relaxed );
+
+	mSignal( frame );
+}
+
+void Device::enableGesture( Gesture::Type t )
+{
+	if ( mController != 0 ) {
+		mController->enableGesture( t );
+	}
+}
+
+void Device::dispatch( const Frame& frame )
+{
+	mSignalTracking( frame );
+	if ( mDispatchRunning ) {
+		{
+			lock_guard<mutex> lock( mDispatchMutex );
+			mDispatchFrames.push( frame );
+		}
+		mDispatchCondition.notify_one();
+	}
+}
+
+const Screen& Device::getClosestScreen( const Pointable& p ) const
+{
+	const Leap::ScreenList& screens = mController->calibratedScreens();
+	if ( screens.empty() ) {
+		throw ExcNoCalibratedScreens();
+	}
+	Leap::Screen closestScreen = screens.closestScreenHit( p.mPointable );
+	for ( ScreenMap::const_iterator iter = mScreens.begin(); iter != mScreens.end(); ++iter ) {
+		const Screen& screen = iter->second;
+		if ( screen.mScreen.id() == closestScreen.id() ) {
+			return screen;
+		}
+	}
+	if ( mScreens.begin() != mScreens.end() ) {
+		return mScreens.begin()->second;
+	}
+	throw ExcNoClosestScreen();
+}
+	
+Leap::Config Device::getConfig() const
+{
+	return mController->config();
+}
+
+const ConfigSnapshot& Device::getConfigSnapshot() const
+{
+	return mConfig;
+}
+	
+Frame Device::getInterpolatedFrame()
+{
+	return getInterpolatedFrame( getTimestamp() - kInterpolationDelay );
+}
+
+Frame Device::getInterpolatedFrame( int64_t timestamp )
+{
+	mRecording = true;
+
+	FrameSnapshot snapshot;
+	{
+		lock_guard<mutex> lock( mHistoryMutex );
+		if ( mHistoryCount == 0 ) {
+			return Frame();
+		} else if ( mHistoryCount == 1 ) {
+			return fromFrameSnapshot( mHistory[ 0 ] );
+		}
+		const FrameSnapshot& a	= mHistory[ mHistoryCount % 2 ];
+		const FrameSnapshot& b	= mHistory[ ( mHistoryCount - 1 ) % 2 ];
+		int64_t span			= b.mTimestamp - a.mTimestamp;
+		float t					= span > 0 ? (float)( (double)( timestamp - a.mTimestamp ) / (double)span ) : 1.0f;
+		interpolateFrameSnapshot( a, b, t, &snapshot );
+	}
+	return fromFrameSnapshot( snapshot );
+}
+
+uint32_t Device::getFields() const
+{
+	return mFields.load( memory_order_relaxed );
+}
+
+const ScreenMap& Device::getScreens() const
+{
+	return mScreens;
+}
+
+int64_t Device::getTimestamp() const
+{
+	lock_guard<mutex> lock( mHistoryMutex );
+	return mHistoryCount == 0 ? 0 : (int64_t)getClockMicroseconds() - mHistoryOffset;
+}
+
+DeviceStats Device::getStats() const
+{
+	DeviceStats stats;
+	stats.mFramesDelivered	= mFramesDelivered.load( memory_order_relaxed );
+	stats.mFramesDropped	= mFramesDropped.load( memory_order_relaxed );
+	stats.mFramesReceived	= mFramesReceived.load( memory_order_relaxed );
+	stats.mFrameRate		= mFrameRate.load( memory_order_relaxed );
+	stats.mHandCount		= mHandCount.load( memory_order_relaxed );
+	stats.mLockCount		= mLockCount.load( memory_order_relaxed );
+	stats.mLockMaxWaitTime	= mLockMaxWaitTime.load( memory_order_relaxed );
+	stats.mLockWaitTime		= mLockWaitTime.load( memory_order_relaxed );
+	stats.mPointableCount	= mPointableCount.load( memory_order_relaxed );
+
+	lock_guard<mutex> lock( mStatsMutex );
+	for ( CallbackCounterMap::const_iterator iter = mCallbackCounters.begin(); iter != mCallbackCounters.end(); ++iter ) {
+		DeviceStats::CallbackStats callback;
+		callback.mCalls		= iter->second->mCalls.load( memory_order_relaxed );
+		callback.mId		= iter->first;
+		callback.mMaxTime	= iter->second->mMaxTime.load( memory_order_relaxed );
+		callback.mTime		= iter->second->mTime.load( memory_order_relaxed );
+		stats.mCallbacks.push_back( callback );
+	}
+	return stats;
+}
+
+int64_t Device::getStallTime() const
+{
+	return mStallTime;
+}
+
+Device::State Device::getState() const
+{
+	State state = (State)mListener.mState.load();
+	if ( state == STATE_STREAMING && 
+		(int64_t)getClockMicroseconds() - mListener.mFrameTime.load( memory_order_relaxed ) > mStallTime ) {
+		state = STATE_STALLED;
+	}
+	return state;
+}
+
+bool Device::hasExited() const
+{
+	return mListener.mState == STATE_EXITED;
+}
+	
+bool Device::isConnected() const
+{
+	int32_t state = mListener.mState;
+	return state == STATE_CONNECTED || state == STATE_STREAMING || state == STATE_STALLED;
+}
+
+bool Device::isDispatching() const
+{
+	return !mSignalTracking.empty() || !mSignalWorker.empty();
+}
+
+bool Device::isInitialized() const
+{
+	return mListener.mInitialized;
+}
+
+bool Device::isPipelined() const
+{
+	return mListener.mPipelined;
+}
+
+void Device::notifyState( State state )
+{
+	if ( state != mNotifiedState ) {
+		mNotifiedState = state;
+		mSignalState( state );
+	}
+}
+
+void Device::process()
+{
+	int64_t id = -1;
+	while ( mRunning ) {
+		
+		// The Leap thread pushes while holding the lock, so a 
+		// frame cannot arrive between the check and the wait
+		{
+			unique_lock<mutex> lock( mThreadMutex );
+			while ( mRunning && mListener.mPendingFrames.empty() ) {
+				mCondition.wait( lock );
+			}
+		}
+
+		// Skip to the newest native frame
+		Leap::Frame leapFrame;
+		uint64_t received = 0;
+		while ( mListener.mPendingFrames.pop( &leapFrame ) ) {
+			++received;
+		}
+		if ( received > 1 ) {
+			mFramesDropped.fetch_add( received - 1, memory_order_relaxed );
+		}
+		if ( received == 0 || leapFrame.id() == id ) {
+			continue;
+		}
+		id = leapFrame.id();
+
+		// Convert and queue for delivery on the main thread. When 
+		// update() has not kept up, the finished frame is dropped.
+		Frame frame( leapFrame, mRecording ? (uint32_t)Frame::FIELD_ALL : getFields() );
+		if ( mRecording ) {
+			record( frame );
+		}
+		if ( !mListener.mFirstFrameReceived ) {
+			lock_guard<mutex> lock( mMutex );
+			mListener.mFirstFrame			= frame;
+			mListener.mFirstFrameReceived	= true;
+		}
+		if ( !mFrames.push( frame ) ) {
+			mFramesDropped.fetch_add( 1, memory_order_relaxed );
+		}
+		if ( isDispatching() ) {
+			dispatch( frame );
+		}
+	}
+	releaseTraceThread( getTraceOwner() );
+}
+
+void Device::record( const Frame& frame )
+{
+	int64_t clock = (int64_t)getClockMicroseconds();
+	lock_guard<mutex> lock( mHistoryMutex );
+	FrameSnapshot& snapshot = mHistory[ mHistoryCount % 2 ];
+	toFrameSnapshot( frame, &snapshot );
+	alignClock( clock, snapshot.mTimestamp, mHistoryCount == 0, &mHistoryOffset );
+	++mHistoryCount;
+}
+
+void Device::refreshConfig()
+{
+	ConfigSnapshot config = fromLeapConfig( mController->config() );
+	if ( config != mConfig ) {
+		mConfig = config;
+		mSignalConfig( mConfig );
+	}
+}
+
+void Device::removeCallback( uint32_t id )
+{
+	if ( mCallbacks.find( id ) != mCallbacks.end() ) {
+		mCallbacks.find( id )->second->disconnect();
+		mCallbacks.erase( id ); 
+	}
+
+	mCallbackFields.erase( id );
+	updateFields();
+
+	lock_guard<mutex> lock( mStatsMutex );
+	mCallbackCounters.erase( id );
+}
+
+void Device::resetStats()
+{
+	mFramesDelivered.store( 0, memory_order_relaxed );
+	mFramesDropped.store( 0, memory_order_relaxed );
+	mFramesReceived.store( 0, memory_order_relaxed );
+	mFrameRate.store( 0.0f, memory_order_relaxed );
+	mHandCount.store( 0, memory_order_relaxed );
+	mLockCount.store( 0, memory_order_relaxed );
+	mLockMaxWaitTime.store( 0, memory_order_relaxed );
+	mLockWaitTime.store( 0, memory_order_relaxed );
+	mPointableCount.store( 0, memory_order_relaxed );
+
+	lock_guard<mutex> lock( mStatsMutex );
+	for ( CallbackCounterMap::const_iterator iter = mCallbackCounters.begin(); iter != mCallbackCounters.end(); ++iter ) {
+		iter->second->mCalls.store( 0, memory_order_relaxed );
+		iter->second->mMaxTime.store( 0, memory_order_relaxed );
+		iter->second->mTime.store( 0, memory_order_relaxed );
+	}
+}
+
+void Device::runDispatch()
+{
+	while ( mDispatchRunning ) {
+		{
+			unique_lock<mutex> lock( mDispatchMutex );
+			while ( mDispatchRunning && mDispatchFrames.empty() ) {
+				mDispatchCondition.wait( lock );
+			}
+		}
+
+		Frame frame;
+		while ( mDispatchFrames.pop( &frame ) ) {
+			mSignalWorker( frame );
+		}
+	}
+	releaseTraceThread( getTraceOwner() );
+}
+
+void Device::setStallTime( int64_t microseconds )
+{
+	mStallTime = math<int64_t>::max( microseconds, 0 );
+}
+
+function<void ( Frame )> Device::timeCallback( uint32_t id, const function<void ( Frame )>& callback )
+{
+	CallbackCounterRef counter( new CallbackCounter() );
+	counter->mCalls		= 0;
+	counter->mMaxTime	= 0;
+	counter->mTime		= 0;
+	{
+		lock_guard<mutex> lock( mStatsMutex );
+		mCallbackCounters[ id ] = counter;
+	}
+
+	return [ callback, counter, id ]( Frame frame )
+	{
+		int64_t start = (int64_t)getClockMicroseconds();
+		{
+			TraceSpan span( "Device callback", id );
+			callback( frame );
+		}
+		int64_t time = (int64_t)getClockMicroseconds() - start;
+		counter->mCalls.fetch_add( 1, memory_order_relaxed );
+		counter->mTime.fetch_add( time, memory_order_relaxed );
+		storeMax( counter->mMaxTime, time );
+	};
+}
+
+void Device::startDispatch()
+{
+	if ( !mDispatchThread ) {
+		mDispatchRunning	= true;
+		mDispatchThread		= shared_ptr<thread>( new thread( &Device::runDispatch, this ) );
+	}
+}
+
+void Device::update()
+{
+	TraceSpan span( "Device::update" );
+
+	// Pass on transitions made on Leap's thread. The current state is 
+	// checked as well, in case transitions overflowed the queue.
+	int32_t state;
+	while ( mListener.mTransitions.pop( &state ) ) {
+		notifyState( (State)state );
+	}
+	state = mListener.mState;
+	int32_t streaming = STATE_STREAMING;
+	if ( getState() == STATE_STALLED && 
+		mListener.mState.compare_exchange_strong( streaming, STATE_STALLED ) ) {
+		state = STATE_STALLED;
+	}
+	notifyState( (State)state );
+
+	if ( mListener.mPipelined ) {
+		Frame frame;
+		uint64_t received = 0;
+		while ( mFrames.pop( &frame ) ) {
+			++received;
+		}
+		if ( received > 1 ) {
+			mFramesDropped.fetch_add( received - 1, memory_order_relaxed );
+		}
+		if ( received > 0 ) {
+			deliver( frame );
+		}
+	} else {
+		int64_t start = (int64_t)getClockMicroseconds();
+		lock_guard<mutex> lock( mMutex );
+		int64_t wait = (int64_t)getClockMicroseconds() - start;
+		mLockCount.fetch_add( 1, memory_order_relaxed );
+		mLockWaitTime.fetch_add( wait, memory_order_relaxed );
+		storeMax( mLockMaxWaitTime, wait );
+		if ( mListener.mNewFrame ) {
+			deliver( mListener.mFrame );
+			mListener.mNewFrame = false;
+		}
+	}
+	
+	// Read configuration once the controller has connected
+	if ( isConnected() && mConfigPending.exchange( false ) ) {
+		refreshConfig();
+	}
+	
+	TraceSpan screenSpan( "Device::update screens" );
+	const Leap::ScreenList& screens = mController->calibratedScreens();
+	mScreens.clear();
+	size_t count = screens.count();
+	for ( size_t i = 0; i < count; ++i ) {
+		mScreens[ i ] = Screen( screens[ i ] );
+	}
+}
+
+void Device::updateFields()
+{
+	// Frames already converted keep the old fields
+	uint32_t fields = 0;
+	for ( map<uint32_t, uint32_t>::const_iterator iter = mCallbackFields.begin(); iter != mCallbackFields.end(); ++iter ) {
+		fields |= iter->second;
+	}
+	mFields.store( fields, memory_order_relaxed );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Resampling starts over when frames are further apart than this, in microseconds
+static const int64_t kFrameQueueMaxGap = 1000000;
+
+FrameQueueRef FrameQueue::create( Policy policy, size_t capacity )
+{
+	return FrameQueueRef( new FrameQueue( policy, capacity ) );
+}
+
+FrameQueue::FrameQueue( Policy policy, size_t capacity )
+	: mPolicy( policy ), mSlots( math<size_t>::max( capacity, 2 ) )
+{
+	for ( vector<Slot>::iterator iter = mSlots.begin(); iter != mSlots.end(); ++iter ) {
+		iter->mSequence = 0;
+	}
+	mDropped		= 0;
+	mHasNext		= false;
+	mHasPrevious	= false;
+	mRate			= 30.0f;
+	mReadCount		= 0;
+	mTick			= 0;
+	mWriteCount		= 0;
+}
+
+FrameQueue::~FrameQueue()
+{
+	for ( CallbackList::const_iterator iter = mCallbacks.begin(); iter != mCallbacks.end(); ++iter ) {
+		iter->second->disconnect();
+	}
+	mCallbacks.clear();
+}
+
+size_t FrameQueue::getCapacity() const
+{
+	return mSlots.size();
+}
+
+uint64_t FrameQueue::getFramesDropped() const
+{
+	return mDropped.load( memory_order_relaxed );
+}
+
+FrameQueue::Policy FrameQueue::getPolicy() const
+{
+	return mPolicy;
+}
+
+float FrameQueue::getRate() const
+{
+	return mRate;
+}
+
+bool FrameQueue::merge( FrameSnapshot* snapshot )
+{
+	uint64_t read	= mReadCount.load( memory_order_relaxed );
+	uint64_t write	= mWriteCount.load( memory_order_acquire );
+	if ( write == read || !readSlot( write - 1, snapshot ) ) {
+		return false;
+	}
+
+	// Sum the newest frame and every skipped frame still in the 
+	// queue. The slot after the newest may be mid-write.
+	uint64_t first = write - read >= mSlots.size() ? write - mSlots.size() + 1 : read;
+	uint32_t handCounts[ FrameSnapshot::MAX_HANDS ];
+	Vec3f handPositions[ FrameSnapshot::MAX_HANDS ];
+	Vec3f handVelocities[ FrameSnapshot::MAX_HANDS ];
+	for ( uint32_t i = 0; i < snapshot->mHandCount; ++i ) {
+		handCounts[ i ]		= 1;
+		handPositions[ i ]	= snapshot->mHands[ i ].mPosition;
+		handVelocities[ i ]	= snapshot->mHands[ i ].mVelocity;
+	}
+	uint32_t pointableCounts[ FrameSnapshot::MAX_POINTABLES ];
+	Vec3f pointablePositions[ FrameSnapshot::MAX_POINTABLES ];
+	Vec3f pointableVelocities[ FrameSnapshot::MAX_POINTABLES ];
+	for ( uint32_t i = 0; i < snapshot->mPointableCount; ++i ) {
+		pointableCounts[ i ]		= 1;
+		pointablePositions[ i ]		= snapshot->mPointables[ i ].mPosition;
+		pointableVelocities[ i ]	= snapshot->mPointables[ i ].mVelocity;
+	}
+	for ( uint64_t index = first; index + 1 < write; ++index ) {
+		if ( !readSlot( index, &mScratch ) ) {
+			continue;
+		}
+		for ( uint32_t i = 0; i < snapshot->mHandCount; ++i ) {
+			for ( uint32_t j = 0; j < mScratch.mHandCount; ++j ) {
+				if ( mScratch.mHands[ j ].mId == snapshot->mHands[ i ].mId ) {
+					++handCounts[ i ];
+					handPositions[ i ]	+= mScratch.mHands[ j ].mPosition;
+					handVelocities[ i ]	+= mScratch.mHands[ j ].mVelocity;
+					break;
+				}
+			}
+		}
+		for ( uint32_t i = 0; i < snapshot->mPointableCount; ++i ) {
+			for ( uint32_t j = 0; j < mScratch.mPointableCount; ++j ) {
+				if ( mScratch.mPointables[ j ].mId == snapshot->mPointables[ i ].mId ) {
+					++pointableCounts[ i ];
+					pointablePositions[ i ]		+= mScratch.mPointables[ j ].mPosition;
+					pointableVelocities[ i ]	+= mScratch.mPointables[ j ].mVelocity;
+					break;
+				}
+			}
+		}
+	}
+	for ( uint32_t i = 0; i < snapshot->mHandCount; ++i ) {
+		snapshot->mHands[ i ].mPosition	= handPositions[ i ] / (float)handCounts[ i ];
+		snapshot->mHands[ i ].mVelocity	= handVelocities[ i ] / (float)handCounts[ i ];
+	}
+	for ( uint32_t i = 0; i < snapshot->mPointableCount; ++i ) {
+		snapshot->mPointables[ i ].mPosition	= pointablePositions[ i ] / (float)pointableCounts[ i ];
+		snapshot->mPointables[ i ].mVelocity	= pointableVelocities[ i ] / (float)pointableCounts[ i ];
+	}
+
+	mDropped.fetch_add( first - read, memory_order_relaxed );
+	mReadCount.store( write, memory_order_release );
+	return true;
+}
+
+bool FrameQueue::pop( FrameSnapshot* snapshot )
+{
+	if ( mPolicy == POLICY_MERGE ) {
+		return merge( snapshot );
+	} else if ( mPolicy == POLICY_RESAMPLE ) {
+		return resample( snapshot );
+	}
+
+	// Retry if the producer laps the consumer mid-copy
+	uint64_t read = mReadCount.load( memory_order_relaxed );
+	for ( size_t attempt = 0; attempt < 4; ++attempt ) {
+		uint64_t write = mWriteCount.load( memory_order_acquire );
+		if ( write == read ) {
+			return false;
+		}
+		uint64_t index = mPolicy == POLICY_LATEST ? write - 1 : read;
+		if ( readSlot( index, snapshot ) ) {
+			mDropped.fetch_add( index - read, memory_order_relaxed );
+			mReadCount.store( index + 1, memory_order_release );
+			return true;
+		}
+	}
+	return false;
+}
+
+void FrameQueue::push( Frame frame )
+{
+	uint64_t count = mWriteCount.load( memory_order_relaxed );
+
+	// These policies keep unread frames, so the new one is dropped
+	if ( mPolicy == POLICY_OLDEST || mPolicy == POLICY_QUEUE ) {
+		uint64_t limit = mPolicy == POLICY_OLDEST ? 1 : mSlots.size();
+		if ( count - mReadCount.load( memory_order_acquire ) >= limit ) {
+			mDropped.fetch_add( 1, memory_order_relaxed );
+			return;
+		}
+	}
+
+	// An odd sequence marks the slot as being written
+	Slot& slot			= mSlots[ count % mSlots.size() ];
+	uint32_t sequence	= slot.mSequence.load( memory_order_relaxed );
+	slot.mSequence.store( sequence + 1, memory_order_relaxed );
+	atomic_thread_fence( memory_order_release );
+	toFrameSnapshot( frame, &slot.mFrame );
+	slot.mSequence.store( sequence + 2, memory_order_release );
+
+	mWriteCount.store( count + 1, memory_order_release );
+}
+
+bool FrameQueue::readSlot( uint64_t index, FrameSnapshot* snapshot )
+{
+	const Slot& slot	= mSlots[ index % mSlots.size() ];
+	uint32_t sequence	= slot.mSequence.load( memory_order_acquire );
+	if ( ( sequence & 1 ) != 0 ) {
+		return false;
+	}
+	memcpy( snapshot, &slot.mFrame, sizeof( FrameSnapshot ) );
+	atomic_thread_fence( memory_order_acquire );
+
+	// Also fails if the producer lapped the slot before the copy began
+	return slot.mSequence.load( memory_order_relaxed ) == sequence && 
+		mWriteCount.load( memory_order_relaxed ) - index <= mSlots.size();
+}
+
+void FrameQueue::removeCallback( uint32_t id )
+{
+	if ( mCallbacks.find( id ) != mCallbacks.end() ) {
+		mCallbacks.find( id )->second->disconnect();
+		mCallbacks.erase( id ); 
+	}
+}
+
+bool FrameQueue::resample( FrameSnapshot* snapshot )
+{
+	if ( mRate <= 0.0f ) {
+		return false;
+	}
+	int64_t interval = math<int64_t>::max( (int64_t)( 1000000.0 / (double)mRate ), 1 );
+
+	// Walk the frames in order, stopping at each tick that falls 
+	// between the previous frame and the next one
+	while ( true ) {
+		if ( !mHasNext ) {
+			uint64_t read	= mReadCount.load( memory_order_relaxed );
+			uint64_t write	= mWriteCount.load( memory_order_acquire );
+			if ( write == read ) {
+				return false;
+			}
+			uint64_t first = write - read >= mSlots.size() ? write - mSlots.size() + 1 : read;
+			if ( !readSlot( first, &mNext ) ) {
+				return false;
+			}
+			mDropped.fetch_add( first - read, memory_order_relaxed );
+			mReadCount.store( first + 1, memory_order_release );
+			mHasNext = true;
+		}
+
+		// Start over on the first frame, after a gap, or when time runs backwards
+		if ( !mHasPrevious || mNext.mTimestamp < mPrevious.mTimestamp || 
+			mNext.mTimestamp - mTick > kFrameQueueMaxGap ) {
+			mHasNext		= false;
+			mHasPrevious	= true;
+			mPrevious		= mNext;
+			mTick			= mPrevious.mTimestamp + interval;
+			*snapshot		= mPrevious;
+			return true;
+		}
+
+		if ( mNext.mTimestamp >= mTick ) {
+			int64_t span	= math<int64_t>::max( mNext.mTimestamp - mPrevious.mTimestamp, 1 );
+			float t			= (float)( mTick - mPrevious.mTimestamp ) / (float)span;
+			interpolateFrameSnapshot( mPrevious, mNext, t, snapshot );
+			mTick			+= interval;
+			return true;
+		}
+		mHasNext	= false;
+		mPrevious	= mNext;
+	}
+}
+
+void FrameQueue::setRate( float rate )
+{
+	mRate = math<float>::max( rate, 0.0f );
+}
+
+void FrameQueue::update()
+{
+	// Bounded so that a fast producer cannot keep the consumer here
+	for ( size_t i = 0; i < mSlots.size() && pop( &mSnapshot ); ++i ) {
+		mSignal( fromFrameSnapshot( mSnapshot ) );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Shared memory layout: a header followed by an array of slots
+static const uint32_t kSharedMemoryMagic = 0x4c454150; // "LEAP"
+
+struct SharedFrameHeader
+{
+	uint32_t				mMagic;
+	uint32_t				mSlotCount;
+	// Guards against publishers built with a different snapshot layout
+	uint32_t				mSlotSize;
+	std::atomic<uint64_t>	mWriteCount;
+};
+
+struct SharedFrameSlot
+{
+	std::atomic<uint32_t>	mSequence;
+	FrameSnapshot			mFrame;
+};
+
+static SharedFrameSlot* getSharedFrameSlots( void* data )
+{
+	return (SharedFrameSlot*)( (char*)data + sizeof( SharedFrameHeader ) );
+}
+
+// Maps shared memory named "name". Creates it with size "size" if 
+// "create" is true, failing if it exists. Otherwise, the existing size 
+// is written to "size". "exists" is set when creating failed because 
+// the name is taken.
+static bool openSharedMemory( const string& name, bool create, size_t* size, void** handle, void** data, bool* exists )
+{
+	*exists = false;
+#if defined( CINDER_MSW )
+	HANDLE mapping = 0;
+	if ( create ) {
+		mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, (DWORD)*size, name.c_str() );
+		if ( mapping != 0 && GetLastError() == ERROR_ALREADY_EXISTS ) {
+			CloseHandle( mapping );
+			*exists = true;
+			return false;
+		}
+	} else {
+		mapping = OpenFileMappingA( FILE_MAP_ALL_ACCESS, FALSE, name.c_str() );
+	}
+	if ( mapping == 0 ) {
+		return false;
+	}
+	*data = MapViewOfFile( mapping, FILE_MAP_ALL_ACCESS, 0, 0, create ? *size : 0 );
+	if ( *data == 0 ) {
+		CloseHandle( mapping );
+		return false;
+	}
+	if ( !create ) {
+		MEMORY_BASIC_INFORMATION info;
+		VirtualQuery( *data, &info, sizeof( info ) );
+		*size = info.RegionSize;
+	}
+	*handle = mapping;
+#else
+	string path	= "/" + name;
+	int fd		= create ? shm_open( path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666 ) : shm_open( path.c_str(), O_RDWR, 0 );
+	if ( fd < 0 ) {
+		*exists = create && errno == EEXIST;
+		return false;
+	}
+	if ( create ) {
+		if ( ftruncate( fd, (off_t)*size ) != 0 ) {
+			close( fd );
+			shm_unlink( path.c_str() );
+			return false;
+		}
+	} else {
+		struct stat info;
+		if ( fstat( fd, &info ) != 0 ) {
+			close( fd );
+			return false;
+		}
+		*size = (size_t)info.st_size;
+	}
+	*data = mmap( 0, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( *data == MAP_FAILED ) {
+		*data = 0;
+		return false;
+	}
+	*handle = 0;
+#endif
+	return true;
+}
+
+static void closeSharedMemory( const string& name, bool unlink, size_t size, void* handle, void* data )
+{
+#if defined( CINDER_MSW )
+	if ( data != 0 ) {
+		UnmapViewOfFile( data );
+	}
+	if ( handle != 0 ) {
+		CloseHandle( (HANDLE)handle );
+	}
+#else
+	(void)handle;
+	if ( data != 0 ) {
+		munmap( data, size );
+	}
+	if ( unlink ) {
+		shm_unlink( ( "/" + name ).c_str() );
+	}
+#endif
+}
+
+SharedMemoryPublisherRef SharedMemoryPublisher::create( const string& name, size_t slotCount, bool replace )
+{
+	return SharedMemoryPublisherRef( new SharedMemoryPublisher( name, slotCount, replace ) );
+}
+
+SharedMemoryPublisher::SharedMemoryPublisher( const string& name, size_t slotCount, bool replace )
+{
+	mData	= 0;
+	mHandle	= 0;
+	mName	= name;
+	mSize	= sizeof( SharedFrameHeader ) + sizeof( SharedFrameSlot ) * math<size_t>::max( slotCount, 1 );
+
+#if !defined( CINDER_MSW )
+	if ( replace ) {
+		shm_unlink( ( "/" + mName ).c_str() );
+	}
+#endif
+	bool exists = false;
+	if ( !openSharedMemory( mName, true, &mSize, &mHandle, &mData, &exists ) ) {
+		throw ExcSharedMemory( mName, exists );
+	}
+
+	memset( mData, 0, mSize );
+	SharedFrameHeader* header	= (SharedFrameHeader*)mData;
+	header->mSlotCount			= (uint32_t)math<size_t>::max( slotCount, 1 );
+	header->mSlotSize			= (uint32_t)sizeof( SharedFrameSlot );
+	header->mWriteCount			= 0;
+	atomic_thread_fence( memory_order_release );
+	header->mMagic				= kSharedMemoryMagic;
+}
+
+SharedMemoryPublisher::~SharedMemoryPublisher()
+{
+	closeSharedMemory( mName, true, mSize, mHandle, mData );
+}
+
+const string& SharedMemoryPublisher::getName() const
+{
+	return mName;
+}
+
+void SharedMemoryPublisher::publish( Frame frame )
+{
+	SharedFrameHeader* header	= (SharedFrameHeader*)mData;
+	uint64_t count				= header->mWriteCount.load( memory_order_relaxed );
+	SharedFrameSlot& slot		= getSharedFrameSlots( mData )[ count % header->mSlotCount ];
+
+	// An odd sequence marks the slot as being written
+	uint32_t sequence = slot.mSequence.load( memory_order_relaxed );
+	slot.mSequence.store( sequence + 1, memory_order_relaxed );
+	atomic_thread_fence( memory_order_release );
+	toFrameSnapshot( frame, &slot.mFrame );
+	slot.mSequence.store( sequence + 2, memory_order_release );
+	
+	header->mWriteCount.store( count + 1, memory_order_release );
+}
+
+SharedMemorySubscriberRef SharedMemorySubscriber::create( const string& name )
+{
+	return SharedMemorySubscriberRef( new SharedMemorySubscriber( name ) );
+}
+
+SharedMemorySubscriber::SharedMemorySubscriber( const string& name )
+{
+	mData		= 0;
+	mHandle		= 0;
+	mName		= name;
+	mReadCount	= 0;
+	mSize		= 0;
+	mSlotCount	= 0;
+	bool exists = false;
+	if ( !openSharedMemory( mName, false, &mSize, &mHandle, &mData, &exists ) ) {
+		throw ExcSharedMemory( mName );
+	}
+	
+	// The header is read once. Another process owns it, so it is not 
+	// trusted again after it has been validated.
+	const SharedFrameHeader* header = (const SharedFrameHeader*)mData;
+	if ( mSize >= sizeof( SharedFrameHeader ) && 
+		header->mMagic == kSharedMemoryMagic &&
+		header->mSlotSize == sizeof( SharedFrameSlot ) ) {
+		mSlotCount = header->mSlotCount;
+	}
+	if ( mSlotCount == 0 || 
+		( mSize - sizeof( SharedFrameHeader ) ) / sizeof( SharedFrameSlot ) < mSlotCount ) {
+		closeSharedMemory( mName, false, mSize, mHandle, mData );
+		throw ExcSharedMemory( mName );
+	}
+}
+
+SharedMemorySubscriber::~SharedMemorySubscriber()
+{
+	for ( CallbackList::const_iterator iter = mCallbacks.begin(); iter != mCallbacks.end(); ++iter ) {
+		iter->second->disconnect();
+	}
+	mCallbacks.clear();
+	closeSharedMemory( mName, false, mSize, mHandle, mData );
+}
+
+const string& SharedMemorySubscriber::getName() const
+{
+	return mName;
+}
+
+bool SharedMemorySubscriber::read( FrameSnapshot* snapshot )
+{
+	SharedFrameHeader* header = (SharedFrameHeader*)mData;
+	
+	// Retry if the writer laps this reader mid-copy
+	for ( size_t attempt = 0; attempt < 4; ++attempt ) {
+		uint64_t count = header->mWriteCount.load( memory_order_acquire );
+		if ( count == mReadCount ) {
+			return false;
+		}
+
+		SharedFrameSlot& slot	= getSharedFrameSlots( mData )[ ( count - 1 ) % mSlotCount ];
+		uint32_t sequence		= slot.mSequence.load( memory_order_acquire );
+		if ( ( sequence & 1 ) != 0 ) {
+			continue;
+		}
+		memcpy( snapshot, &slot.mFrame, sizeof( FrameSnapshot ) );
+		atomic_thread_fence( memory_order_acquire );
+		if ( slot.mSequence.load( memory_order_relaxed ) == sequence ) {
+			mReadCount = count;
+			return true;
+		}
+	}
+	return false;
+}
+
+void SharedMemorySubscriber::removeCallback( uint32_t id )
+{
+	if ( mCallbacks.find( id ) != mCallbacks.end() ) {
+		mCallbacks.find( id )->second->disconnect();
+		mCallbacks.erase( id ); 
+	}
+}
+
+void SharedMemorySubscriber::update()
+{
+	if ( read( &mSnapshot ) ) {
+		mSignal( fromFrameSnapshot( mSnapshot ) );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Fixed-point scales for each quantized gesture, hand and pointable value
+static const float kGestureScales[] = {
+	1024.0f, 1024.0f, 1024.0f,	// Direction
+	10.0f, 10.0f, 10.0f,		// Position
+	4096.0f,					// Progress
+	10.0f,						// Radius
+	1.0f,						// Speed
+	10.0f, 10.0f, 10.0f			// Start position
+};
+static const float kHandScales[] = { 
+	1024.0f, 1024.0f, 1024.0f,	// Direction
+	1024.0f, 1024.0f, 1024.0f,	// Normal
+	10.0f, 10.0f, 10.0f,		// Position
+	4096.0f,					// Rotation angle
+	1024.0f, 1024.0f, 1024.0f,	// Rotation axis
+	4096.0f,					// Scale
+	10.0f, 10.0f, 10.0f,		// Sphere position
+	10.0f,						// Sphere radius
+	10.0f, 10.0f, 10.0f,		// Translation
+	1.0f, 1.0f, 1.0f			// Velocity
+};
+static const float kPointableScales[] = {
+	1024.0f, 1024.0f, 1024.0f,	// Direction
+	10.0f,						// Length
+	10.0f, 10.0f, 10.0f,		// Position
+	1.0f, 1.0f, 1.0f,			// Velocity
+	10.0f						// Width
+};
+
+// NaN maps to zero and out of range values saturate, since casting 
+// either to an integer is undefined
+static int32_t quantizeValue( float v, float scale )
+{
+	double q = math<double>::floor( (double)v * scale + 0.5 );
+	if ( q != q ) {
+		return 0;
+	}
+	return (int32_t)math<double>::clamp( q, (double)numeric_limits<int32_t>::min(), (double)numeric_limits<int32_t>::max() );
+}
+
+static void quantizeVector( const Vec3f& v, const float* scales, int32_t* values )
+{
+	values[ 0 ] = quantizeValue( v.x, scales[ 0 ] );
+	values[ 1 ] = quantizeValue( v.y, scales[ 1 ] );
+	values[ 2 ] = quantizeValue( v.z, scales[ 2 ] );
+}
+
+static Vec3f dequantizeVector( const int32_t* values, const float* scales )
+{
+	return Vec3f( (float)values[ 0 ] / scales[ 0 ], (float)values[ 1 ] / scales[ 1 ], (float)values[ 2 ] / scales[ 2 ] );
+}
+
+static uint64_t zigZag( int64_t v )
+{
+	return ( (uint64_t)v << 1 ) ^ (uint64_t)( v >> 63 );
+}
+
+static int64_t unZigZag( uint64_t v )
+{
+	return (int64_t)( v >> 1 ) ^ -(int64_t)( v & 1 );
+}
+
+static void writeVarint( uint64_t v, vector<uint8_t>* buffer )
+{
+	while ( v >= 0x80 ) {
+		buffer->push_back( (uint8_t)( v | 0x80 ) );
+		v >>= 7;
+	}
+	buffer->push_back( (uint8_t)v );
+}
+
+static bool readVarint( const uint8_t* data, size_t size, size_t* offset, uint64_t* v )
+{
+	*v = 0;
+	for ( uint32_t shift = 0; shift < 64 && *offset < size; shift += 7 ) {
+		uint8_t byte	= data[ ( *offset )++ ];
+		*v				|= (uint64_t)( byte & 0x7f ) << shift;
+		if ( ( byte & 0x80 ) == 0 ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+FrameCodec::FrameCodec()
+{
+	reset();
+}
+
+void FrameCodec::dequantize( const QuantizedFrame& q, FrameSnapshot* s )
+{
+	s->mId				= q.mId;
+	s->mTimestamp		= q.mTimestamp;
+	s->mGestureCount	= q.mGestureCount;
+	s->mHandCount		= q.mHandCount;
+	s->mPointableCount	= q.mPointableCount;
+	for ( size_t i = 0; i < q.mGestureCount; ++i ) {
+		const int32_t* v = q.mGestures[ i ];
+		GestureData& gesture = s->mGestures[ i ];
+		gesture.mDirection		= dequantizeVector( v + 0, kGestureScales + 0 );
+		gesture.mDuration		= q.mGestureDurations[ i ];
+		gesture.mId				= q.mGestureIds[ i ];
+		gesture.mPointableId	= q.mGesturePointables[ i ];
+		gesture.mPosition		= dequantizeVector( v + 3, kGestureScales + 3 );
+		gesture.mProgress		= (float)v[ 6 ] / kGestureScales[ 6 ];
+		gesture.mRadius			= (float)v[ 7 ] / kGestureScales[ 7 ];
+		gesture.mSpeed			= (float)v[ 8 ] / kGestureScales[ 8 ];
+		gesture.mStartPosition	= dequantizeVector( v + 9, kGestureScales + 9 );
+		gesture.mState			= (Gesture::State)q.mGestureStates[ i ];
+		gesture.mType			= (Gesture::Type)q.mGestureTypes[ i ];
+	}
+	for ( size_t i = 0; i < q.mHandCount; ++i ) {
+		const int32_t* v = q.mHands[ i ];
+		FrameSnapshot::HandData& hand = s->mHands[ i ];
+		hand.mId				= q.mHandIds[ i ];
+		hand.mDirection			= dequantizeVector( v + 0, kHandScales + 0 );
+		hand.mNormal			= dequantizeVector( v + 3, kHandScales + 3 );
+		hand.mPosition			= dequantizeVector( v + 6, kHandScales + 6 );
+		hand.mRotationAngle		= (float)v[ 9 ] / kHandScales[ 9 ];
+		hand.mRotationAxis		= dequantizeVector( v + 10, kHandScales + 10 );
+		hand.mRotationMatrix	= Matrix44f::createRotation( hand.mRotationAxis, hand.mRotationAngle );
+		hand.mScale				= (float)v[ 13 ] / kHandScales[ 13 ];
+		hand.mSpherePosition	= dequantizeVector( v + 14, kHandScales + 14 );
+		hand.mSphereRadius		= (float)v[ 17 ] / kHandScales[ 17 ];
+		hand.mTranslation		= dequantizeVector( v + 18, kHandScales + 18 );
+		hand.mVelocity			= dequantizeVector( v + 21, kHandScales + 21 );
+	}
+	for ( size_t i = 0; i < q.mPointableCount; ++i ) {
+		const int32_t* v = q.mPointables[ i ];
+		FrameSnapshot::PointableData& pointable = s->mPointables[ i ];
+		pointable.mDirection	= dequantizeVector( v + 0, kPointableScales + 0 );
+		pointable.mHandId		= q.mHandIds[ q.mPointableHands[ i ] ];
+		pointable.mId			= q.mPointableIds[ i ];
+		pointable.mLength		= (float)v[ 3 ] / kPointableScales[ 3 ];
+		pointable.mPosition		= dequantizeVector( v + 4, kPointableScales + 4 );
+		pointable.mTool			= q.mPointableTools[ i ];
+		pointable.mVelocity		= dequantizeVector( v + 7, kPointableScales + 7 );
+		pointable.mWidth		= (float)v[ 10 ] / kPointableScales[ 10 ];
+	}
+}
+
+void FrameCodec::quantize( const FrameSnapshot& s, QuantizedFrame* q )
+{
+	q->mId				= s.mId;
+	q->mTimestamp		= s.mTimestamp;
+	q->mGestureCount	= math<uint32_t>::min( s.mGestureCount, (uint32_t)FrameSnapshot::MAX_GESTURES );
+	q->mHandCount		= math<uint32_t>::min( s.mHandCount, (uint32_t)FrameSnapshot::MAX_HANDS );
+	q->mPointableCount	= 0;
+	for ( size_t i = 0; i < q->mGestureCount; ++i ) {
+		int32_t* v = q->mGestures[ i ];
+		const GestureData& gesture = s.mGestures[ i ];
+		q->mGestureDurations[ i ]	= gesture.mDuration;
+		q->mGestureIds[ i ]			= gesture.mId;
+		q->mGesturePointables[ i ]	= gesture.mPointableId;
+		q->mGestureStates[ i ]		= (int8_t)gesture.mState;
+		q->mGestureTypes[ i ]		= (int8_t)gesture.mType;
+		quantizeVector( gesture.mDirection,		kGestureScales + 0,	v + 0 );
+		quantizeVector( gesture.mPosition,		kGestureScales + 3,	v + 3 );
+		v[ 6 ] = quantizeValue( gesture.mProgress, kGestureScales[ 6 ] );
+		v[ 7 ] = quantizeValue( gesture.mRadius, kGestureScales[ 7 ] );
+		v[ 8 ] = quantizeValue( gesture.mSpeed, kGestureScales[ 8 ] );
+		quantizeVector( gesture.mStartPosition,	kGestureScales + 9,	v + 9 );
+	}
+	for ( size_t i = 0; i < q->mHandCount; ++i ) {
+		int32_t* v = q->mHands[ i ];
+		const FrameSnapshot::HandData& hand = s.mHands[ i ];
+		q->mHandIds[ i ] = hand.mId;
+		quantizeVector( hand.mDirection,		kHandScales + 0,	v + 0 );
+		quantizeVector( hand.mNormal,			kHandScales + 3,	v + 3 );
+		quantizeVector( hand.mPosition,			kHandScales + 6,	v + 6 );
+		v[ 9 ] = quantizeValue( hand.mRotationAngle, kHandScales[ 9 ] );
+		quantizeVector( hand.mRotationAxis,		kHandScales + 10,	v + 10 );
+		v[ 13 ] = quantizeValue( hand.mScale, kHandScales[ 13 ] );
+		quantizeVector( hand.mSpherePosition,	kHandScales + 14,	v + 14 );
+		v[ 17 ] = quantizeValue( hand.mSphereRadius, kHandScales[ 17 ] );
+		quantizeVector( hand.mTranslation,		kHandScales + 18,	v + 18 );
+		quantizeVector( hand.mVelocity,			kHandScales + 21,	v + 21 );
+	}
+
+	// Pointables refer to their hand by index. Orphans are dropped.
+	uint32_t pointableCount = math<uint32_t>::min( s.mPointableCount, (uint32_t)FrameSnapshot::MAX_POINTABLES );
+	for ( size_t i = 0; i < pointableCount; ++i ) {
+		const FrameSnapshot::PointableData& pointable = s.mPointables[ i ];
+		uint32_t hand = 0;
+		while ( hand < q->mHandCount && q->mHandIds[ hand ] != pointable.mHandId ) {
+			++hand;
+		}
+		if ( hand == q->mHandCount ) {
+			continue;
+		}
+		uint32_t index		= q->mPointableCount++;
+		int32_t* v			= q->mPointables[ index ];
+		q->mPointableHands[ index ]	= hand;
+		q->mPointableIds[ index ]	= pointable.mId;
+		q->mPointableTools[ index ]	= pointable.mTool != 0 ? 1 : 0;
+		quantizeVector( pointable.mDirection,	kPointableScales + 0,	v + 0 );
+		v[ 3 ] = quantizeValue( pointable.mLength, kPointableScales[ 3 ] );
+		quantizeVector( pointable.mPosition,	kPointableScales + 4,	v + 4 );
+		quantizeVector( pointable.mVelocity,	kPointableScales + 7,	v + 7 );
+		v[ 10 ] = quantizeValue( pointable.mWidth, kPointableScales[ 10 ] );
+	}
+}
+
+void FrameCodec::reset()
+{
+	mHasPrevious	= false;
+	mSequence		= 0;
+}
+
+void FrameEncoder::encode( const FrameSnapshot& s, bool keyFrame, vector<uint8_t>* buffer )
+{
+	QuantizedFrame q;
+	quantize( s, &q );
+	keyFrame						= keyFrame || !mHasPrevious;
+	const QuantizedFrame* previous	= keyFrame ? 0 : &mPrevious;
+
+	// Reserve space for body length
+	size_t start = buffer->size();
+	buffer->push_back( 0 );
+	buffer->push_back( 0 );
+	
+	buffer->push_back( keyFrame ? 1 : 0 );
+	writeVarint( mSequence, buffer );
+	writeVarint( zigZag( previous != 0 ? q.mId - previous->mId : q.mId ), buffer );
+	writeVarint( zigZag( previous != 0 ? q.mTimestamp - previous->mTimestamp : q.mTimestamp ), buffer );
+
+	writeVarint( q.mHandCount, buffer );
+	for ( size_t i = 0; i < q.mHandCount; ++i ) {
+		const int32_t* reference = 0;
+		for ( size_t j = 0; previous != 0 && j < previous->mHandCount && reference == 0; ++j ) {
+			if ( previous->mHandIds[ j ] == q.mHandIds[ i ] ) {
+				reference = previous->mHands[ j ];
+			}
+		}
+		writeVarint( zigZag( q.mHandIds[ i ] ), buffer );
+		for ( size_t j = 0; j < HAND_VALUES; ++j ) {
+			writeVarint( zigZag( (int64_t)q.mHands[ i ][ j ] - ( reference != 0 ? reference[ j ] : 0 ) ), buffer );
+		}
+	}
+
+	writeVarint( q.mPointableCount, buffer );
+	for ( size_t i = 0; i < q.mPointableCount; ++i ) {
+		const int32_t* reference = 0;
+		for ( size_t j = 0; previous != 0 && j < previous->mPointableCount && reference == 0; ++j ) {
+			if ( previous->mPointableIds[ j ] == q.mPointableIds[ i ] ) {
+				reference = previous->mPointables[ j ];
+			}
+		}
+		writeVarint( zigZag( q.mPointableIds[ i ] ), buffer );
+		writeVarint( q.mPointableHands[ i ], buffer );
+		buffer->push_back( q.mPointableTools[ i ] );
+		for ( size_t j = 0; j < POINTABLE_VALUES; ++j ) {
+			writeVarint( zigZag( (int64_t)q.mPointables[ i ][ j ] - ( reference != 0 ? reference[ j ] : 0 ) ), buffer );
+		}
+	}
+
+	writeVarint( q.mGestureCount, buffer );
+	for ( size_t i = 0; i < q.mGestureCount; ++i ) {
+		writeVarint( zigZag( q.mGestureIds[ i ] ), buffer );
+		buffer->push_back( (uint8_t)q.mGestureTypes[ i ] );
+		buffer->push_back( (uint8_t)q.mGestureStates[ i ] );
+		writeVarint( zigZag( q.mGesturePointables[ i ] ), buffer );
+		writeVarint( zigZag( q.mGestureDurations[ i ] ), buffer );
+		for ( size_t j = 0; j < GESTURE_VALUES; ++j ) {
+			writeVarint( zigZag( q.mGestures[ i ][ j ] ), buffer );
+		}
+	}
+
+	size_t length				= buffer->size() - start - 2;
+	( *buffer )[ start + 0 ]	= (uint8_t)( length & 0xff );
+	( *buffer )[ start + 1 ]	= (uint8_t)( ( length >> 8 ) & 0xff );
+
+	mHasPrevious	= true;
+	mPrevious		= q;
+	++mSequence;
+}
+
+bool FrameDecoder::decode( const uint8_t* data, size_t size, size_t* offset, FrameSnapshot* s )
+{
+	if ( *offset + 2 > size ) {
+		*offset = size;
+		return false;
+	}
+	size_t length	= (size_t)data[ *offset ] | ( (size_t)data[ *offset + 1 ] << 8 );
+	size_t pos		= *offset + 2;
+	size_t end		= pos + length;
+	if ( end > size || length == 0 ) {
+		*offset = size;
+		return false;
+	}
+	*offset = end;
+
+	bool keyFrame = ( data[ pos++ ] & 1 ) != 0;
+	uint64_t sequence = 0;
+	if ( !readVarint( data, end, &pos, &sequence ) ) {
+		return false;
+	}
+	
+	// A delta frame can only be decoded on top of the frame before it
+	if ( !keyFrame && ( !mHasPrevious || (uint32_t)sequence != mSequence + 1 ) ) {
+		mHasPrevious = false;
+		return false;
+	}
+	const QuantizedFrame* previous = keyFrame ? 0 : &mPrevious;
+
+	QuantizedFrame q;
+	uint64_t v = 0;
+	if ( !readVarint( data, end, &pos, &v ) ) {
+		return false;
+	}
+	q.mId = unZigZag( v ) + ( previous != 0 ? previous->mId : 0 );
+	if ( !readVarint( data, end, &pos, &v ) ) {
+		return false;
+	}
+	q.mTimestamp = unZigZag( v ) + ( previous != 0 ? previous->mTimestamp : 0 );
+
+	if ( !readVarint( data, end, &pos, &v ) || v > FrameSnapshot::MAX_HANDS ) {
+		return false;
+	}
+	q.mHandCount = (uint32_t)v;
+	for ( size_t i = 0; i < q.mHandCount; ++i ) {
+		if ( !readVarint( data, end, &pos, &v ) ) {
+			return false;
+		}
+		q.mHandIds[ i ] = (int32_t)unZigZag( v );
+		const int32_t* reference = 0;
+		for ( size_t j = 0; previous != 0 && j < previous->mHandCount && reference == 0; ++j ) {
+			if ( previous->mHandIds[ j ] == q.mHandIds[ i ] ) {
+				reference = previous->mHands[ j ];
+			}
+		}
+		for ( size_t j = 0; j < HAND_VALUES; ++j ) {
+			if ( !readVarint( data, end, &pos, &v ) ) {
+				return false;
+			}
+			q.mHands[ i ][ j ] = (int32_t)( unZigZag( v ) + ( reference != 0 ? reference[ j ] : 0 ) );
+		}
+	}
+
+	if ( !readVarint( data, end, &pos, &v ) || v > FrameSnapshot::MAX_POINTABLES ) {
+		return false;
+	}
+	q.mPointableCount = (uint32_t)v;
+	for ( size_t i = 0; i < q.mPointableCount; ++i ) {
+		if ( !readVarint( data, end, &pos, &v ) ) {
+			return false;
+		}
+		q.mPointableIds[ i ] = (int32_t)unZigZag( v );
+		if ( !readVarint( data, end, &pos, &v ) || v >= q.mHandCount || pos >= end ) {
+			return false;
+		}
+		q.mPointableHands[ i ]	= (uint32_t)v;
+		q.mPointableTools[ i ]	= data[ pos++ ];
+		const int32_t* reference = 0;
+		for ( size_t j = 0; previous != 0 && j < previous->mPointableCount && reference == 0; ++j ) {
+			if ( previous->mPointableIds[ j ] == q.mPointableIds[ i ] ) {
+				reference = previous->mPointables[ j ];
+			}
+		}
+		for ( size_t j = 0; j < POINTABLE_VALUES; ++j ) {
+			if ( !readVarint( data, end, &pos, &v ) ) {
+				return false;
+			}
+			q.mPointables[ i ][ j ] = (int32_t)( unZigZag( v ) + ( reference != 0 ? reference[ j ] : 0 ) );
+		}
+	}
+
+	if ( !readVarint( data, end, &pos, &v ) || v > FrameSnapshot::MAX_GESTURES ) {
+		return false;
+	}
+	q.mGestureCount = (uint32_t)v;
+	for ( size_t i = 0; i < q.mGestureCount; ++i ) {
+		if ( !readVarint( data, end, &pos, &v ) || pos + 2 > end ) {
+			return false;
+		}
+		q.mGestureIds[ i ]		= (int32_t)unZigZag( v );
+		q.mGestureTypes[ i ]	= (int8_t)data[ pos++ ];
+		q.mGestureStates[ i ]	= (int8_t)data[ pos++ ];
+		if ( !readVarint( data, end, &pos, &v ) ) {
+			return false;
+		}
+		q.mGesturePointables[ i ] = (int32_t)unZigZag( v );
+		if ( !readVarint( data, end, &pos, &v ) ) {
+			return false;
+		}
+		q.mGestureDurations[ i ] = unZigZag( v );
+		for ( size_t j = 0; j < GESTURE_VALUES; ++j ) {
+			if ( !readVarint( data, end, &pos, &v ) ) {
+				return false;
+			}
+			q.mGestures[ i ][ j ] = (int32_t)unZigZag( v );
+		}
+	}
+
+	mHasPrevious	= true;
+	mPrevious		= q;
+	mSequence		= (uint32_t)sequence;
+	dequantize( q, s );
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Packets are a 16-bit length followed by a frame count, the sender's 
+// clock in microseconds and that many encoded frames.
+static const size_t kPacketHeaderSize = 11;
+// Largest packet, including its length. Fits the 16-bit length and 
+// the payload of one UDP datagram.
+static const size_t kPacketMaxSize = 65507;
+// Packets queued for a TCP client before it is considered stalled
+static const size_t kSendQueueSize = 8;
+// UDP clients renew their subscription every second and are 
+// dropped after this many microseconds without renewing
+static const uint64_t kSubscriptionTimeout = 5000000;
+// First byte of a datagram from a UDP client
+static const uint8_t kRequestRenew		= 0;
+static const uint8_t kRequestKeyFrame	= 1;
+
+// Returns true if any frame in \a packet is a key frame
+static bool hasKeyFrame( const vector<uint8_t>& packet )
+{
+	size_t count	= packet[ 2 ];
+	size_t offset	= kPacketHeaderSize;
+	for ( size_t i = 0; i < count && offset + 2 < packet.size(); ++i ) {
+		if ( ( packet[ offset + 2 ] & 1 ) != 0 ) {
+			return true;
+		}
+		offset += 2 + ( (size_t)packet[ offset ] | ( (size_t)packet[ offset + 1 ] << 8 ) );
+	}
+	return false;
+}
+
+struct FrameServer::Connection
+{
+	// A TCP client and the packets waiting to be written to it
+	struct Peer
+	{
+		deque<shared_ptr<vector<uint8_t> > >		mQueue;
+		// Set when packets were dropped. Nothing more is queued 
+		// until a key frame lets the client decode again.
+		bool										mResync;
+		shared_ptr<boost::asio::ip::tcp::socket>	mSocket;
+	};
+	typedef shared_ptr<Peer>					PeerRef;
+
+	// A UDP client and when it last renewed its subscription
+	struct Subscriber
+	{
+		boost::asio::ip::udp::endpoint				mEndpoint;
+		uint64_t									mRenewTime;
+	};
+
+	Connection( uint16_t port, StreamProtocol protocol );
+	~Connection();
+
+	void										accept();
+	void										receive();
+	void										send( shared_ptr<vector<uint8_t> > packet );
+	void										write( PeerRef peer );
+
+	shared_ptr<boost::asio::ip::tcp::acceptor>	mAcceptor;
+	atomic<uint64_t>							mBytesSent;
+	boost::asio::io_service						mIo;
+	atomic<bool>								mKeyFrameRequested;
+	vector<PeerRef>								mPeers;
+	shared_ptr<boost::asio::ip::tcp::socket>	mPendingSocket;
+	uint8_t										mReceiveBuffer[ 16 ];
+	boost::asio::ip::udp::endpoint				mSender;
+	shared_ptr<boost::asio::ip::udp::socket>	mSocket;
+	vector<Subscriber>							mSubscribers;
+	shared_ptr<thread>							mThread;
+	shared_ptr<boost::asio::io_service::work>	mWork;
+};
+
+FrameServer::Connection::Connection( uint16_t port, StreamProtocol protocol )
+{
+	using namespace boost::asio::ip;
+	mBytesSent			= 0;
+	mKeyFrameRequested	= false;
+	try {
+		if ( protocol == STREAM_PROTOCOL_TCP ) {
+			mAcceptor = shared_ptr<tcp::acceptor>( new tcp::acceptor( mIo, tcp::endpoint( tcp::v4(), port ) ) );
+			accept();
+		} else {
+			mSocket = shared_ptr<udp::socket>( new udp::socket( mIo, udp::endpoint( udp::v4(), port ) ) );
+			receive();
+		}
+	} catch ( boost::system::system_error& ex ) {
+		throw ExcStream( ex.what() );
+	}
+	mWork	= shared_ptr<boost::asio::io_service::work>( new boost::asio::io_service::work( mIo ) );
+	mThread	= shared_ptr<thread>( new thread( [ this ]() { mIo.run(); } ) );
+}
+
+FrameServer::Connection::~Connection()
+{
+	mWork.reset();
+	mIo.stop();
+	mThread->join();
+}
+
+void FrameServer::Connection::accept()
+{
+	mPendingSocket = shared_ptr<boost::asio::ip::tcp::socket>( new boost::asio::ip::tcp::socket( mIo ) );
+	mAcceptor->async_accept( *mPendingSocket, [ this ]( const boost::system::error_code& err )
+	{
+		if ( !err ) {
+			mPendingSocket->set_option( boost::asio::ip::tcp::no_delay( true ) );
+			PeerRef peer( new Peer() );
+			peer->mResync	= false;
+			peer->mSocket	= mPendingSocket;
+			mPeers.push_back( peer );
+			mKeyFrameRequested = true;
+		}
+		if ( err != boost::asio::error::operation_aborted ) {
+			accept();
+		}
+	} );
+}
+
+// Clients send a short datagram to subscribe, to renew the subscription 
+// and to ask for a key frame. New subscribers always get a key frame.
+void FrameServer::Connection::receive()
+{
+	mSocket->async_receive_from( boost::asio::buffer( mReceiveBuffer ), mSender, 
+		[ this ]( const boost::system::error_code& err, size_t bytes )
+	{
+		if ( !err ) {
+			vector<Subscriber>::iterator iter = mSubscribers.begin();
+			while ( iter != mSubscribers.end() && iter->mEndpoint != mSender ) {
+				++iter;
+			}
+			if ( iter == mSubscribers.end() ) {
+				Subscriber subscriber;
+				subscriber.mEndpoint	= mSender;
+				subscriber.mRenewTime	= 0;
+				iter = mSubscribers.insert( mSubscribers.end(), subscriber );
+				mKeyFrameRequested = true;
+			}
+			iter->mRenewTime = getClockMicroseconds();
+			if ( bytes == 0 || mReceiveBuffer[ 0 ] != kRequestRenew ) {
+				mKeyFrameRequested = true;
+			}
+		}
+		if ( err != boost::asio::error::operation_aborted ) {
+			receive();
+		}
+	} );
+}
+
+// Called on the network thread. TCP writes are queued per client so 
+// a slow client can not hold up the others.
+void FrameServer::Connection::send( shared_ptr<vector<uint8_t> > packet )
+{
+	for ( vector<PeerRef>::const_iterator iter = mPeers.begin(); iter != mPeers.end(); ++iter ) {
+		const PeerRef& peer = *iter;
+		bool full = peer->mQueue.size() >= kSendQueueSize;
+		if ( peer->mResync ) {
+			if ( full || !hasKeyFrame( *packet ) ) {
+				// Ask for a key frame once the client is reading again
+				if ( !full ) {
+					mKeyFrameRequested = true;
+				}
+				continue;
+			}
+			peer->mResync = false;
+		} else if ( full ) {
+			peer->mResync = true;
+			continue;
+		}
+		peer->mQueue.push_back( packet );
+		if ( peer->mQueue.size() == 1 ) {
+			write( peer );
+		}
+	}
+
+	boost::system::error_code err;
+	uint64_t time = getClockMicroseconds();
+	for ( size_t i = 0; i < mSubscribers.size(); ) {
+		if ( time - mSubscribers[ i ].mRenewTime > kSubscriptionTimeout ) {
+			mSubscribers.erase( mSubscribers.begin() + i );
+			continue;
+		}
+		mSocket->send_to( boost::asio::buffer( *packet ), mSubscribers[ i ].mEndpoint, 0, err );
+		if ( err ) {
+			mSubscribers.erase( mSubscribers.begin() + i );
+		} else {
+			mBytesSent += packet->size();
+			++i;
+		}
+	}
+}
+
+void FrameServer::Connection::write( PeerRef peer )
+{
+	boost::asio::async_write( *peer->mSocket, boost::asio::buffer( *peer->mQueue.front() ), 
+		[ this, peer ]( const boost::system::error_code& err, size_t bytes )
+	{
+		if ( err ) {
+			if ( err != boost::asio::error::operation_aborted ) {
+				mPeers.erase( remove( mPeers.begin(), mPeers.end(), peer ), mPeers.end() );
+			}
+			return;
+		}
+		mBytesSent += bytes;
+		peer->mQueue.pop_front();
+		if ( !peer->mQueue.empty() ) {
+			write( peer );
+		}
+	} );
+}
+
+FrameServerRef FrameServer::create( uint16_t port, StreamProtocol protocol )
+{
+	return FrameServerRef( new FrameServer( port, protocol ) );
+}
+
+FrameServer::FrameServer( uint16_t port, StreamProtocol protocol )
+{
+	mBatchCount			= 0;
+	mBatchSize			= 2;
+	mConnection			= shared_ptr<Connection>( new Connection( port, protocol ) );
+	mKeyFrameCount		= 0;
+	mKeyFrameInterval	= 120;
+}
+
+FrameServer::~FrameServer()
+{
+	mConnection.reset();
+}
+
+size_t FrameServer::getBatchSize() const
+{
+	return mBatchSize;
+}
+
+uint64_t FrameServer::getBytesSent() const
+{
+	return mConnection->mBytesSent;
+}
+
+size_t FrameServer::getKeyFrameInterval() const
+{
+	return mKeyFrameInterval;
+}
+
+void FrameServer::flush()
+{
+	size_t length	= mBuffer.size() - 2;
+	uint64_t clock	= getClockMicroseconds();
+	mBuffer[ 0 ]	= (uint8_t)( length & 0xff );
+	mBuffer[ 1 ]	= (uint8_t)( ( length >> 8 ) & 0xff );
+	mBuffer[ 2 ]	= (uint8_t)mBatchCount;
+	for ( size_t i = 0; i < 8; ++i ) {
+		mBuffer[ 3 + i ] = (uint8_t)( ( clock >> ( i * 8 ) ) & 0xff );
+	}
+	mConnection->mIo.post( bind( &Connection::send, mConnection.get(), 
+		shared_ptr<vector<uint8_t> >( new vector<uint8_t>( mBuffer ) ) ) );
+	mBatchCount = 0;
+}
+
+void FrameServer::publish( Frame frame )
+{
+	bool keyFrame = mKeyFrameCount == 0 || mConnection->mKeyFrameRequested.exchange( false );
+	toFrameSnapshot( frame, &mSnapshot );
+	mFrameBuffer.clear();
+	mEncoder.encode( mSnapshot, keyFrame, &mFrameBuffer );
+	mKeyFrameCount = keyFrame ? 1 : ( mKeyFrameCount + 1 ) % math<size_t>::max( mKeyFrameInterval, 1 );
+
+	// Send what is batched if this frame would not fit. Frames are 
+	// decoded in order whichever packet they arrive in, so splitting 
+	// a batch does not break delta coding.
+	if ( mBatchCount > 0 && mBuffer.size() + mFrameBuffer.size() > kPacketMaxSize ) {
+		flush();
+	}
+	if ( mBatchCount == 0 ) {
+		mBuffer.clear();
+		mBuffer.resize( kPacketHeaderSize, 0 );
+	}
+	mBuffer.insert( mBuffer.end(), mFrameBuffer.begin(), mFrameBuffer.end() );
+	++mBatchCount;
+
+	if ( mBatchCount >= mBatchSize ) {
+		flush();
+	}
+}
+
+void FrameServer::setBatchSize( size_t count )
+{
+	mBatchSize = math<size_t>::clamp( count, 1, 255 );
+}
+
+void FrameServer::setKeyFrameInterval( size_t count )
+{
+	mKeyFrameInterval = count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+struct FrameClient::Connection
+{
+	Connection( const string& host, uint16_t port, StreamProtocol protocol );
+	~Connection();
+
+	void										read();
+	void										readPacket( size_t bytes );
+	void										receive();
+	void										request( uint8_t type );
+	void										subscribe();
+	
+	vector<uint8_t>								mBuffer;
+	atomic<uint64_t>							mBytesReceived;
+	FrameDecoder								mDecoder;
+	RingBuffer<FrameSnapshot, 16>				mFrames;
+	atomic<uint64_t>							mFramesDropped;
+	atomic<uint64_t>							mFramesReceived;
+	boost::asio::io_service						mIo;
+	FrameSnapshot								mLatest;
+	atomic<uint64_t>							mLatency;
+	// Bytes received when the subscription was last renewed
+	uint64_t									mRenewBytes;
+	// Datagrams from anywhere but the server are ignored
+	boost::asio::ip::udp::endpoint				mSender;
+	boost::asio::ip::udp::endpoint				mServer;
+	FrameSnapshot								mSnapshot;
+	shared_ptr<boost::asio::ip::tcp::socket>	mTcpSocket;
+	shared_ptr<thread>							mThread;
+	shared_ptr<boost::asio::deadline_timer>		mTimer;
+	shared_ptr<boost::asio::ip::udp::socket>	mUdpSocket;
+	shared_ptr<boost::asio::io_service::work>	mWork;
+};
+
+FrameClient::Connection::Connection( const string& host, uint16_t port, StreamProtocol protocol )
+{
+	using namespace boost::asio::ip;
+	mBuffer.resize( kPacketMaxSize );
+	mBytesReceived	= 0;
+	mFramesDropped	= 0;
+	mFramesReceived	= 0;
+	mLatency		= 0;
+	mRenewBytes		= 0;
+	try {
+		if ( protocol == STREAM_PROTOCOL_TCP ) {
+			tcp::resolver resolver( mIo );
+			tcp::resolver::query query( tcp::v4(), host, to_string( port ) );
+			mTcpSocket = shared_ptr<tcp::socket>( new tcp::socket( mIo ) );
+			boost::asio::connect( *mTcpSocket, resolver.resolve( query ) );
+			mTcpSocket->set_option( tcp::no_delay( true ) );
+			read();
+		} else {
+			udp::resolver resolver( mIo );
+			udp::resolver::query query( udp::v4(), host, to_string( port ) );
+			mServer		= *resolver.resolve( query );
+			mUdpSocket	= shared_ptr<udp::socket>( new udp::socket( mIo, udp::endpoint( udp::v4(), 0 ) ) );
+			mTimer		= shared_ptr<boost::asio::deadline_timer>( new boost::asio::deadline_timer( mIo ) );
+			request( kRequestKeyFrame );
+			subscribe();
+			receive();
+		}
+	} catch ( boost::system::system_error& ex ) {
+		throw ExcStream( ex.what() );
+	}
+	mWork	= shared_ptr<boost::asio::io_service::work>( new boost::asio::io_service::work( mIo ) );
+	mThread	= shared_ptr<thread>( new thread( [ this ]() { mIo.run(); } ) );
+}
+
+FrameClient::Connection::~Connection()
+{
+	mWork.reset();
+	mIo.stop();
+	mThread->join();
+}
+
+void FrameClient::Connection::read()
+{
+	boost::asio::async_read( *mTcpSocket, boost::asio::buffer( &mBuffer[ 0 ], 2 ), 
+		[ this ]( const boost::system::error_code& err, size_t )
+	{
+		if ( err ) {
+			return;
+		}
+
+		// A length this large can only come from a corrupt or hostile 
+		// stream, and the stream can not be resynchronized
+		size_t length = (size_t)mBuffer[ 0 ] | ( (size_t)mBuffer[ 1 ] << 8 );
+		if ( length > mBuffer.size() - 2 ) {
+			boost::system::error_code closeErr;
+			mTcpSocket->close( closeErr );
+			return;
+		}
+		boost::asio::async_read( *mTcpSocket, boost::asio::buffer( &mBuffer[ 2 ], length ), 
+			[ this ]( const boost::system::error_code& err, size_t bytes )
+		{
+			if ( !err ) {
+				readPacket( bytes + 2 );
+				read();
+			}
+		} );
+	} );
+}
+
+// Decodes every frame in the packet. Called on the network thread.
+void FrameClient::Connection::readPacket( size_t bytes )
+{
+	mBytesReceived += bytes;
+	if ( bytes < kPacketHeaderSize ) {
+		return;
+	}
+	size_t count	= mBuffer[ 2 ];
+	uint64_t clock	= 0;
+	for ( size_t i = 0; i < 8; ++i ) {
+		clock |= (uint64_t)mBuffer[ 3 + i ] << ( i * 8 );
+	}
+
+	size_t offset = kPacketHeaderSize;
+	for ( size_t i = 0; i < count && offset < bytes; ++i ) {
+		if ( mDecoder.decode( &mBuffer[ 0 ], bytes, &offset, &mSnapshot ) ) {
+			mFrames.push( mSnapshot );
+			++mFramesReceived;
+			
+			// Running average latency in microseconds
+			uint64_t latency	= getClockMicroseconds() - clock;
+			uint64_t average	= mLatency;
+			mLatency			= average == 0 ? latency : ( average * 15 + latency ) / 16;
+		} else {
+			++mFramesDropped;
+			request( kRequestKeyFrame );
+		}
+	}
+}
+
+void FrameClient::Connection::receive()
+{
+	mUdpSocket->async_receive_from( boost::asio::buffer( mBuffer ), mSender, 
+		[ this ]( const boost::system::error_code& err, size_t bytes )
+	{
+		if ( !err && mSender == mServer ) {
+			readPacket( bytes );
+		}
+		if ( err != boost::asio::error::operation_aborted ) {
+			receive();
+		}
+	} );
+}
+
+void FrameClient::Connection::request( uint8_t type )
+{
+	if ( mUdpSocket ) {
+		boost::system::error_code err;
+		mUdpSocket->send_to( boost::asio::buffer( &type, 1 ), mServer, 0, err );
+	}
+}
+
+// Renews the UDP subscription every second. If nothing arrived in that 
+// second the server may have restarted or dropped this client, so the 
+// renewal also asks for a key frame.
+void FrameClient::Connection::subscribe()
+{
+	mTimer->expires_from_now( boost::posix_time::seconds( 1 ) );
+	mTimer->async_wait( [ this ]( const boost::system::error_code& err )
+	{
+		if ( !err ) {
+			uint64_t bytes = mBytesReceived;
+			request( bytes == mRenewBytes ? kRequestKeyFrame : kRequestRenew );
+			mRenewBytes = bytes;
+			subscribe();
+		}
+	} );
+}
+
+FrameClientRef FrameClient::create( const string& host, uint16_t port, StreamProtocol protocol )
+{
+	return FrameClientRef( new FrameClient( host, port, protocol ) );
+}
+
+FrameClient::FrameClient( const string& host, uint16_t port, StreamProtocol protocol )
+{
+	mConnection = shared_ptr<Connection>( new Connection( host, port, protocol ) );
+}
+
+FrameClient::~FrameClient()
+{
+	for ( CallbackList::const_iterator iter = mCallbacks.begin(); iter != mCallbacks.end(); ++iter ) {
+		iter->second->disconnect();
+	}
+	mCallbacks.clear();
+	mConnection.reset();
+}
+
+uint64_t FrameClient::getBytesReceived() const
+{
+	return mConnection->mBytesReceived;
+}
+
+uint64_t FrameClient::getFramesDropped() const
+{
+	return mConnection->mFramesDropped;
+}
+
+uint64_t FrameClient::getFramesReceived() const
+{
+	return mConnection->mFramesReceived;
+}
+
+double FrameClient::getLatency() const
+{
+	return (double)mConnection->mLatency * 0.000001;
+}
+
+void FrameClient::removeCallback( uint32_t id )
+{
+	if ( mCallbacks.find( id ) != mCallbacks.end() ) {
+		mCallbacks.find( id )->second->disconnect();
+		mCallbacks.erase( id ); 
+	}
+}
+
+void FrameClient::update()
+{
+	bool received = false;
+	while ( mConnection->mFrames.pop( &mConnection->mLatest ) ) {
+		received = true;
+	}
+	if ( received ) {
+		mSignal( fromFrameSnapshot( mConnection->mLatest ) );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+template<size_t N> 
+DeviceGroup::IdMap<N>::IdMap()
+	: mCount( 0 )
+{
+}
+
+template<size_t N> 
+void DeviceGroup::IdMap<N>::add( int32_t id, int32_t fusedId )
+{
+	if ( mCount < N ) {
+		mFusedIds[ mCount ]	= fusedId;
+		mIds[ mCount ]		= id;
+		++mCount;
+	}
+}
+
+template<size_t N> 
+int32_t DeviceGroup::IdMap<N>::find( int32_t id ) const
+{
+	for ( uint32_t i = 0; i < mCount; ++i ) {
+		if ( mIds[ i ] == id ) {
+			return mFusedIds[ i ];
+		}
+	}
+	return -1;
+}
+
+DeviceGroup::Source::Source( DeviceGroup* group, uint32_t index )
+	: mCalibration( Matrix44f::identity() ), mGroup( group ), mHasFrame( false ), 
+	mIndex( index ), mNew( false ), mOffset( 0 )
+{
+}
+
+void DeviceGroup::Source::align( int64_t clock )
+{
+	alignClock( clock, mFrame.mTimestamp, !mHasFrame, &mOffset );
+	mHasFrame	= true;
+	mNew		= true;
+}
+
+void DeviceGroup::Source::onFrame( Frame frame )
+{
+	mGroup->push( mIndex, frame );
+}
+
+DeviceGroupRef DeviceGroup::create()
+{
+	return DeviceGroupRef( new DeviceGroup() );
+}
+
+DeviceGroup::DeviceGroup()
+	: mFrameId( 0 ), mMaxAge( 50000 ), mMergeDistance( 80.0f ), mNextGestureId( 0 ), 
+	mNextHandId( 0 ), mNextPointableId( 0 )
+{
+}
+
+DeviceGroup::~DeviceGroup()
+{
+	for ( CallbackList::const_iterator iter = mCallbacks.begin(); iter != mCallbacks.end(); ++iter ) {
+		iter->second->disconnect();
+	}
+	mCallbacks.clear();
+	for ( vector<shared_ptr<Source> >::const_iterator iter = mSources.begin(); iter != mSources.end(); ++iter ) {
+		if ( ( *iter )->mDisconnect ) {
+			( *iter )->mDisconnect();
+		}
+	}
+	mSources.clear();
+}
+
+uint32_t DeviceGroup::addSource( const Matrix44f& calibration )
+{
+	lock_guard<mutex> lock( mMutex );
+	uint32_t index = (uint32_t)mSources.size();
+	mSources.push_back( shared_ptr<Source>( new Source( this, index ) ) );
+	mSources.back()->mCalibration = calibration;
+	return index;
+}
+
+void DeviceGroup::fuse( FrameSnapshot* s )
+{
+	lock_guard<mutex> lock( mMutex );
+
+	// Time of the newest frame on the host clock
+	bool found		= false;
+	int64_t time	= 0;
+	for ( vector<shared_ptr<Source> >::const_iterator iter = mSources.begin(); iter != mSources.end(); ++iter ) {
+		const Source& source = **iter;
+		if ( source.mHasFrame ) {
+			int64_t t	= source.mFrame.mTimestamp + source.mOffset;
+			time		= found ? math<int64_t>::max( time, t ) : t;
+			found		= true;
+		}
+	}
+
+	s->mId				= mFrameId;
+	s->mTimestamp		= time;
+	s->mGestureCount	= 0;
+	s->mHandCount		= 0;
+	s->mPointableCount	= 0;
+	for ( uint32_t i = 0; i < (uint32_t)mSources.size(); ++i ) {
+		const Source& source	= *mSources[ i ];
+		int64_t age				= time - ( source.mFrame.mTimestamp + source.mOffset );
+		if ( source.mHasFrame && age <= mMaxAge ) {
+			merge( i, (float)age * 0.000001f, s );
+		}
+	}
+
+	// Turn weighted sums into averages
+	for ( uint32_t i = 0; i < s->mHandCount; ++i ) {
+		FrameSnapshot::HandData& hand = s->mHands[ i ];
+		float scale				= 1.0f / mHandWeights[ i ];
+		hand.mDirection			= hand.mDirection.safeNormalized();
+		hand.mNormal			= hand.mNormal.safeNormalized();
+		hand.mPosition			*= scale;
+		hand.mRotationAngle		*= scale;
+		hand.mRotationAxis		= hand.mRotationAxis.safeNormalized();
+		hand.mRotationMatrix	= hand.mRotationAxis.lengthSquared() > 0.0f ? 
+			Matrix44f::createRotation( hand.mRotationAxis, hand.mRotationAngle ) : Matrix44f::identity();
+		hand.mScale				*= scale;
+		hand.mSpherePosition	*= scale;
+		hand.mSphereRadius		*= scale;
+		hand.mTranslation		*= scale;
+		hand.mVelocity			*= scale;
+	}
+	for ( uint32_t i = 0; i < s->mPointableCount; ++i ) {
+		FrameSnapshot::PointableData& pointable = s->mPointables[ i ];
+		float scale				= 1.0f / mPointableWeights[ i ];
+		pointable.mDirection	= pointable.mDirection.safeNormalized();
+		pointable.mLength		*= scale;
+		pointable.mPosition		*= scale;
+		pointable.mVelocity		*= scale;
+		pointable.mWidth		*= scale;
+	}
+}
+
+Matrix44f DeviceGroup::getCalibration( uint32_t index ) const
+{
+	lock_guard<mutex> lock( mMutex );
+	return index < mSources.size() ? mSources[ index ]->mCalibration : Matrix44f::identity();
+}
+
+int64_t DeviceGroup::getMaxAge() const
+{
+	return mMaxAge;
+}
+
+float DeviceGroup::getMergeDistance() const
+{
+	return mMergeDistance;
+}
+
+size_t DeviceGroup::getSourceCount() const
+{
+	lock_guard<mutex> lock( mMutex );
+	return mSources.size();
+}
+
+// Adds one source's frame to the fused frame. Called with the mutex 
+// locked. Hands and pointables are summed, weighted by the inverse of 
+// their distance from the sensor, and averaged in fuse().
+void DeviceGroup::merge( uint32_t index, float age, FrameSnapshot* s )
+{
+	Source& source			= *mSources[ index ];
+	const FrameSnapshot& f	= source.mFrame;
+	const Matrix44f& m		= source.mCalibration;
+
+	IdMap<FrameSnapshot::MAX_HANDS> handIds;
+	int32_t handSlots[ FrameSnapshot::MAX_HANDS ];
+	uint32_t handCount = math<uint32_t>::min( f.mHandCount, (uint32_t)FrameSnapshot::MAX_HANDS );
+	for ( uint32_t i = 0; i < handCount; ++i ) {
+		const FrameSnapshot::HandData& hand = f.mHands[ i ];
+		Vec3f velocity	= m.transformVec( hand.mVelocity );
+		Vec3f position	= m.transformPointAffine( hand.mPosition ) + velocity * age;
+		int32_t fusedId	= source.mHandIds.find( hand.mId );
+
+		// Prefer the hand this one was merged into last frame, then 
+		// the nearest. Never merge two hands from the same source.
+		bool taken		= false;
+		float nearest	= mMergeDistance;
+		int32_t slot	= -1;
+		for ( uint32_t j = 0; j < s->mHandCount; ++j ) {
+			const FrameSnapshot::HandData& fused = s->mHands[ j ];
+			taken = taken || fused.mId == fusedId;
+			if ( mHandSources[ j ] == index ) {
+				continue;
+			}
+			float distance = position.distance( fused.mPosition / mHandWeights[ j ] );
+			if ( distance < mMergeDistance && fused.mId == fusedId ) {
+				slot = (int32_t)j;
+				break;
+			}
+			if ( distance < nearest ) {
+				nearest	= distance;
+				slot	= (int32_t)j;
+			}
+		}
+		if ( slot < 0 ) {
+			if ( s->mHandCount >= FrameSnapshot::MAX_HANDS ) {
+				handSlots[ i ] = -1;
+				continue;
+			}
+			slot				= (int32_t)s->mHandCount++;
+			s->mHands[ slot ]	= FrameSnapshot::HandData();
+			s->mHands[ slot ].mId	= taken || fusedId < 0 ? mNextHandId++ : fusedId;
+			mHandWeights[ slot ]	= 0.0f;
+		}
+
+		FrameSnapshot::HandData& fused = s->mHands[ slot ];
+		float weight			= 1.0f / math<float>::max( hand.mPosition.length(), 1.0f );
+		fused.mDirection		+= m.transformVec( hand.mDirection ) * weight;
+		fused.mNormal			+= m.transformVec( hand.mNormal ) * weight;
+		fused.mPosition			+= position * weight;
+		fused.mRotationAngle	+= hand.mRotationAngle * weight;
+		fused.mRotationAxis		+= m.transformVec( hand.mRotationAxis ) * weight;
+		fused.mScale			+= hand.mScale * weight;
+		fused.mSpherePosition	+= ( m.transformPointAffine( hand.mSpherePosition ) + velocity * age ) * weight;
+		fused.mSphereRadius		+= hand.mSphereRadius * weight;
+		fused.mTranslation		+= m.transformVec( hand.mTranslation ) * weight;
+		fused.mVelocity			+= velocity * weight;
+		mHandSources[ slot ]	= index;
+		mHandWeights[ slot ]	+= weight;
+		handSlots[ i ]			= slot;
+		handIds.add( hand.mId, fused.mId );
+	}
+	source.mHandIds = handIds;
+
+	// Pointables are merged the same way, within their fused hand
+	IdMap<FrameSnapshot::MAX_POINTABLES> pointableIds;
+	float pointableDistance	= mMergeDistance * 0.25f;
+	uint32_t pointableCount	= math<uint32_t>::min( f.mPointableCount, (uint32_t)FrameSnapshot::MAX_POINTABLES );
+	for ( uint32_t i = 0; i < pointableCount; ++i ) {
+		const FrameSnapshot::PointableData& pointable = f.mPointables[ i ];
+		int32_t handSlot = -1;
+		for ( uint32_t j = 0; j < handCount && handSlot < 0; ++j ) {
+			if ( f.mHands[ j ].mId == pointable.mHandId ) {
+				handSlot = handSlots[ j ];
+			}
+		}
+		if ( handSlot < 0 ) {
+			continue;
+		}
+		int32_t handId	= s->mHands[ handSlot ].mId;
+		int32_t tool	= pointable.mTool != 0 ? 1 : 0;
+		Vec3f velocity	= m.transformVec( pointable.mVelocity );
+		Vec3f position	= m.transformPointAffine( pointable.mPosition ) + velocity * age;
+		int32_t fusedId	= source.mPointableIds.find( pointable.mId );
+
+		bool taken		= false;
+		float nearest	= pointableDistance;
+		int32_t slot	= -1;
+		for ( uint32_t j = 0; j < s->mPointableCount; ++j ) {
+			const FrameSnapshot::PointableData& fused = s->mPointables[ j ];
+			taken = taken || fused.mId == fusedId;
+			if ( mPointableSources[ j ] == index || fused.mHandId != handId || fused.mTool != tool ) {
+				continue;
+			}
+			float distance = position.distance( fused.mPosition / mPointableWeights[ j ] );
+			if ( distance < pointableDistance && fused.mId == fusedId ) {
+				slot = (int32_t)j;
+				break;
+			}
+			if ( distance < nearest ) {
+				nearest	= distance;
+				slot	= (int32_t)j;
+			}
+		}
+		if ( slot < 0 ) {
+			if ( s->mPointableCount >= FrameSnapshot::MAX_POINTABLES ) {
+				continue;
+			}
+			slot					= (int32_t)s->mPointableCount++;
+			s->mPointables[ slot ]	= FrameSnapshot::PointableData();
+			s->mPointables[ slot ].mHandId	= handId;
+			s->mPointables[ slot ].mId		= taken || fusedId < 0 ? mNextPointableId++ : fusedId;
+			s->mPointables[ slot ].mTool	= tool;
+			mPointableWeights[ slot ]		= 0.0f;
+		}
+
+		FrameSnapshot::PointableData& fused = s->mPointables[ slot ];
+		float weight				= 1.0f / math<float>::max( pointable.mPosition.length(), 1.0f );
+		fused.mDirection			+= m.transformVec( pointable.mDirection ) * weight;
+		fused.mLength				+= pointable.mLength * weight;
+		fused.mPosition				+= position * weight;
+		fused.mVelocity				+= velocity * weight;
+		fused.mWidth				+= pointable.mWidth * weight;
+		mPointableSources[ slot ]	= index;
+		mPointableWeights[ slot ]	+= weight;
+		pointableIds.add( pointable.mId, fused.mId );
+	}
+	source.mPointableIds = pointableIds;
+
+	// A gesture made by a finger that an earlier source 
+	// also reported with the same gesture is dropped
+	IdMap<FrameSnapshot::MAX_GESTURES> gestureIds;
+	uint32_t first			= s->mGestureCount;
+	uint32_t gestureCount	= math<uint32_t>::min( f.mGestureCount, (uint32_t)FrameSnapshot::MAX_GESTURES );
+	for ( uint32_t i = 0; i < gestureCount; ++i ) {
+		GestureData gesture	= f.mGestures[ i ];
+		gesture.mPointableId	= gesture.mPointableId < 0 ? -1 : pointableIds.find( gesture.mPointableId );
+		int32_t fusedId			= source.mGestureIds.find( gesture.mId );
+
+		bool taken		= false;
+		int32_t slot	= -1;
+		for ( uint32_t j = 0; j < s->mGestureCount; ++j ) {
+			const GestureData& fused = s->mGestures[ j ];
+			taken = taken || fused.mId == fusedId;
+			if ( slot < 0 && j < first && fused.mType == gesture.mType && 
+				fused.mPointableId >= 0 && fused.mPointableId == gesture.mPointableId ) {
+				slot = (int32_t)j;
+			}
+		}
+		if ( slot >= 0 ) {
+			gestureIds.add( gesture.mId, s->mGestures[ slot ].mId );
+			continue;
+		}
+		if ( s->mGestureCount >= FrameSnapshot::MAX_GESTURES ) {
+			continue;
+		}
+		
+		int32_t id				= taken || fusedId < 0 ? mNextGestureId++ : fusedId;
+		gestureIds.add( gesture.mId, id );
+		gesture.mDirection		= m.transformVec( gesture.mDirection );
+		gesture.mId				= id;
+		gesture.mPosition		= m.transformPointAffine( gesture.mPosition );
+		if ( gesture.mType == Leap::Gesture::TYPE_SWIPE ) {
+			gesture.mStartPosition = m.transformPointAffine( gesture.mStartPosition );
+		}
+		s->mGestures[ s->mGestureCount++ ] = gesture;
+	}
+	source.mGestureIds = gestureIds;
+}
+
+void DeviceGroup::push( uint32_t index, const Frame& frame )
+{
+	int64_t clock = (int64_t)getClockMicroseconds();
+	lock_guard<mutex> lock( mMutex );
+	if ( index < mSources.size() ) {
+		toFrameSnapshot( frame, &mSources[ index ]->mFrame );
+		mSources[ index ]->align( clock );
+	}
+}
+
+void DeviceGroup::push( uint32_t index, const FrameSnapshot& snapshot )
+{
+	int64_t clock = (int64_t)getClockMicroseconds();
+	lock_guard<mutex> lock( mMutex );
+	if ( index < mSources.size() ) {
+		mSources[ index ]->mFrame = snapshot;
+		mSources[ index ]->align( clock );
+	}
+}
+
+void DeviceGroup::removeCallback( uint32_t id )
+{
+	if ( mCallbacks.find( id ) != mCallbacks.end() ) {
+		mCallbacks.find( id )->second->disconnect();
+		mCallbacks.erase( id ); 
+	}
+}
+
+void DeviceGroup::setCalibration( uint32_t index, const Matrix44f& calibration )
+{
+	lock_guard<mutex> lock( mMutex );
+	if ( index < mSources.size() ) {
+		mSources[ index ]->mCalibration = calibration;
+	}
+}
+
+void DeviceGroup::setMaxAge( int64_t microseconds )
+{
+	mMaxAge = math<int64_t>::max( microseconds, 0 );
+}
+
+void DeviceGroup::setMergeDistance( float distance )
+{
+	mMergeDistance = math<float>::max( distance, 0.0f );
+}
+
+void DeviceGroup::update()
+{
+	bool received = false;
+	{
+		lock_guard<mutex> lock( mMutex );
+		for ( vector<shared_ptr<Source> >::const_iterator iter = mSources.begin(); iter != mSources.end(); ++iter ) {
+			received			= received || ( *iter )->mNew;
+			( *iter )->mNew		= false;
+		}
+	}
+	if ( received ) {
+		fuse( &mSnapshot );
+		++mFrameId;
+		mSignal( fromFrameSnapshot( mSnapshot ) );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+// Longest wait between attempts to replace a failed primary
+static const int64_t kReconnectDelayMax = 60000000;
+
+DeviceSupervisorRef DeviceSupervisor::create( bool pipelined, size_t historySize )
+{
+	return DeviceSupervisorRef( new DeviceSupervisor( pipelined, historySize ) );
+}
+
+DeviceSupervisor::DeviceSupervisor( bool pipelined, size_t historySize )
+	: mCallbackId( 0 ), mConnectTime( 0 ), mNewFrame( false ), mPipelined( pipelined ), 
+	mStandbyTime( 0 ), mNewStandbyFrame( false ), mHistory( math<size_t>::max( historySize, 1 ) ), 
+	mHistoryCount( 0 ), mClock( (int64_t)getClockMicroseconds() ), mDeliverTime( mClock ), 
+	mFallback( FALLBACK_REPLAY ), mFallbackTime( 0 ), mId( 0 ), mReconnectDelay( 5000000 ), 
+	mReconnectTime( 5000000 ), mSource( SOURCE_NONE ), mSourceTimestamp( -1 ), mTimestamp( 0 )
+{
+	connect();
+}
+
+DeviceSupervisor::~DeviceSupervisor()
+{
+	clearStandby();
+	mDevice->removeCallback( mCallbackId );
+	for ( CallbackList::const_iterator iter = mCallbacks.begin(); iter != mCallbacks.end(); ++iter ) {
+		iter->second->disconnect();
+	}
+	mCallbacks.clear();
+}
+
+void DeviceSupervisor::clearStandby()
+{
+	if ( mStandbyDisconnect ) {
+		mStandbyDisconnect();
+	}
+	mStandbyDisconnect	= nullptr;
+	mStandbyFrame		= Frame();
+	mStandbyTime		= 0;
+	mStandbyUpdate		= nullptr;
+	mNewStandbyFrame	= false;
+}
+
+void DeviceSupervisor::connect()
+{
+	// Release the old controller before starting another
+	if ( mDevice ) {
+		mDevice->removeCallback( mCallbackId );
+		mDevice.reset();
+	}
+	mDevice			= Device::create( mPipelined );
+	mCallbackId		= mDevice->addCallback( &DeviceSupervisor::onFrame, this );
+	mConnectTime	= mClock;
+	mNewFrame		= false;
+}
+
+void DeviceSupervisor::deliver( Frame frame )
+{
+	// Advance by the source's own time within a source, 
+	// and by the clock across a switch
+	int64_t step		= mSourceTimestamp < 0 ? mClock - mDeliverTime : frame.mTimestamp - mSourceTimestamp;
+	mDeliverTime		= mClock;
+	mSourceTimestamp	= frame.mTimestamp;
+	mTimestamp			+= math<int64_t>::max( step, 1 );
+
+	frame.mId			= ++mId;
+	frame.mTimestamp	= mTimestamp;
+	mSignal( frame );
+}
+
+const DeviceRef& DeviceSupervisor::getDevice() const
+{
+	return mDevice;
+}
+
+DeviceSupervisor::Fallback DeviceSupervisor::getFallback() const
+{
+	return mFallback;
+}
+
+size_t DeviceSupervisor::getHistorySize() const
+{
+	return mHistory.size();
+}
+
+int64_t DeviceSupervisor::getReconnectTime() const
+{
+	return mReconnectTime;
+}
+
+DeviceSupervisor::Source DeviceSupervisor::getSource() const
+{
+	return mSource;
+}
+
+void DeviceSupervisor::onFrame( Frame frame )
+{
+	mFrame		= frame;
+	mNewFrame	= true;
+	toFrameSnapshot( frame, &mHistory[ mHistoryCount % mHistory.size() ] );
+	++mHistoryCount;
+}
+
+void DeviceSupervisor::onStandbyFrame( Frame frame )
+{
+	mStandbyFrame		= frame;
+	mStandbyTime		= (int64_t)getClockMicroseconds();
+	mNewStandbyFrame	= true;
+}
+
+void DeviceSupervisor::removeCallback( uint32_t id )
+{
+	if ( mCallbacks.find( id ) != mCallbacks.end() ) {
+		mCallbacks.find( id )->second->disconnect();
+		mCallbacks.erase( id ); 
+	}
+}
+
+void DeviceSupervisor::replay( FrameSnapshot* snapshot ) const
+{
+	size_t size				= mHistory.size();
+	size_t count			= (size_t)math<uint64_t>::min( mHistoryCount, (uint64_t)size );
+	size_t first			= mHistoryCount < size ? 0 : (size_t)( mHistoryCount % size );
+	const FrameSnapshot& oldest	= mHistory[ first ];
+	const FrameSnapshot& newest	= mHistory[ ( first + count - 1 ) % size ];
+	int64_t duration		= newest.mTimestamp - oldest.mTimestamp;
+	if ( count < 2 || duration <= 0 ) {
+		*snapshot = newest;
+		return;
+	}
+
+	// Blend the recorded frames either side of the loop position
+	int64_t position = oldest.mTimestamp + mFallbackTime % duration;
+	for ( size_t i = 1; i < count; ++i ) {
+		const FrameSnapshot& b = mHistory[ ( first + i ) % size ];
+		if ( b.mTimestamp >= position ) {
+			const FrameSnapshot& a	= mHistory[ ( first + i - 1 ) % size ];
+			int64_t span			= b.mTimestamp - a.mTimestamp;
+			float t					= span > 0 ? (float)( position - a.mTimestamp ) / (float)span : 1.0f;
+			interpolateFrameSnapshot( a, b, t, snapshot );
+			return;
+		}
+	}
+	*snapshot = newest;
+}
+
+void DeviceSupervisor::setFallback( Fallback fallback )
+{
+	mFallback = fallback;
+}
+
+void DeviceSupervisor::setReconnectTime( int64_t microseconds )
+{
+	mReconnectTime	= math<int64_t>::max( microseconds, 0 );
+	mReconnectDelay	= mReconnectTime;
+}
+
+void DeviceSupervisor::update()
+{
+	int64_t clock	= (int64_t)getClockMicroseconds();
+	int64_t elapsed	= clock - mClock;
+	mClock			= clock;
+
+	mDevice->update();
+	if ( mStandbyUpdate ) {
+		mStandbyUpdate();
+	}
+
+	// Replace a primary which has failed for too long, backing off while 
+	// replacements fail. Without a controller the device never leaves 
+	// STATE_INITIALIZING or STATE_CONNECTED, and a new one would not help.
+	Device::State state = mDevice->getState();
+	bool failed = state == Device::STATE_EXITED || state == Device::STATE_DISCONNECTED || 
+		state == Device::STATE_STALLED;
+	if ( state == Device::STATE_STREAMING ) {
+		mConnectTime	= clock;
+		mReconnectDelay	= mReconnectTime;
+	} else if ( failed && clock - mConnectTime > mReconnectDelay ) {
+		connect();
+		mReconnectDelay	= math<int64_t>::min( mReconnectDelay * 2, math<int64_t>::max( mReconnectTime, kReconnectDelayMax ) );
+		state			= mDevice->getState();
+	}
+
+	// Choose the source for this update
+	Source source = SOURCE_NONE;
+	if ( state == Device::STATE_STREAMING ) {
+		source = SOURCE_PRIMARY;
+	} else if ( mStandbyUpdate && mStandbyTime > 0 && clock - mStandbyTime <= mDevice->getStallTime() ) {
+		source = SOURCE_STANDBY;
+	} else if ( mFallback == FALLBACK_REPLAY && mHistoryCount > 0 ) {
+		source = SOURCE_REPLAY;
+	} else if ( mFallback != FALLBACK_NONE ) {
+		source = SOURCE_IDLE;
+	}
+	if ( source != mSource ) {
+		mFallbackTime		= 0;
+		mSource				= source;
+		mSourceTimestamp	= -1;
+		mSignalSource( mSource );
+	}
+
+	if ( mSource == SOURCE_PRIMARY && mNewFrame ) {
+		deliver( mFrame );
+	} else if ( mSource == SOURCE_STANDBY && mNewStandbyFrame ) {
+		deliver( mStandbyFrame );
+	} else if ( mSource == SOURCE_REPLAY || mSource == SOURCE_IDLE ) {
+		if ( mSource == SOURCE_REPLAY ) {
+			replay( &mSnapshot );
+		} else {
+			synthesizeFrameSnapshot( 0, mFallbackTime, 1, &mSnapshot );
+		}
+
+		// Replayed time stamps jump back when the loop restarts, 
+		// so fallback time stands in for them
+		mSnapshot.mTimestamp	= mFallbackTime;
+		mFallbackTime			+= elapsed;
+		deliver( fromFrameSnapshot( mSnapshot ) );
+	}
+	mNewFrame			= false;
+	mNewStandbyFrame	= false;
 }
 
 }
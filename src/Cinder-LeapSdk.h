@@ -38,16 +38,25 @@
 
 #include "Leap.h"
 #include "boost/signals2.hpp"
+#include "cinder/DataSource.h"
 #include "cinder/Exception.h"
 #include "cinder/Matrix.h"
+#include "cinder/Rect.h"
 #include "cinder/Thread.h"
 #include "cinder/Vector.h"
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace LeapSdk {
 
 // Forward declarations
+struct ConfigSnapshot;
 class Finger;
 class Frame;
+struct FrameSnapshot;
+struct GestureData;
 class Device;
 class Hand;
 class Listener;
@@ -57,14 +66,36 @@ class Tool;
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
+//! Reads a native Leap config into a typed snapshot.
+ConfigSnapshot	fromLeapConfig( const Leap::Config& c );
 //! Converts a native Leap finger into a LeapSdk one.
 Finger			fromLeapFinger( const Leap::Finger& f );
 //! Converts a LeapSdk finger into a native Leap one.
 Leap::Finger	toLeapFinger( const Finger& f );
+//! Converts a LeapSdk frame snapshot into a LeapSdk frame.
+Frame			fromFrameSnapshot( const FrameSnapshot& s );
+//! Writes LeapSdk frame \a f into snapshot \a s.
+void			toFrameSnapshot( const Frame& f, FrameSnapshot* s );
+/*! Writes snapshots \a a and \a b blended by \a t into \a s. Hands and 
+	pointables are matched by ID. Positions, velocities and sizes are 
+	interpolated linearly, directions and normals spherically. Anything 
+	else, including unmatched hands and pointables, is copied from the 
+	nearer snapshot. \a t is clamped to the range 0 to 1. */
+void			interpolateFrameSnapshot( const FrameSnapshot& a, const FrameSnapshot& b, 
+										  float t, FrameSnapshot* s );
+/*! Writes a synthetic frame into \a s for testing without a controller. 
+	It holds \a handCount open hands (up to FrameSnapshot::MAX_HANDS) with 
+	five fingers each, swaying above the controller. The frame depends 
+	only on its arguments, so a reader can synthesize the same frame to 
+	check what it received. Hand IDs start at 1000000, and each finger 
+	ID follows its hand's. */
+void			synthesizeFrameSnapshot( int64_t id, int64_t timestamp, size_t handCount, FrameSnapshot* s );
 //! Converts a native Leap frame into a LeapSdk one.
 Frame			fromLeapFrame( const Leap::Frame& f );
 //! Converts a LeapSdk frame into a native Leap one.
 Leap::Frame		toLeapFrame( const Frame& f );
+//! Decodes a native Leap gesture into plain data.
+GestureData		fromLeapGesture( const Leap::Gesture& g );
 //! Converts a native Leap hand into a LeapSdk one.
 Hand			fromLeapHand( const Leap::Hand& h, const Leap::Frame& frame );
 //! Converts a LeapSdk hand into a native Leap one.
@@ -103,26 +134,35 @@ public:
 	Pointable();
 	
 	//! Returns normalized vector of pointing direction.
-	ci::Vec3f		getDirection() const;
+	const ci::Vec3f&	getDirection() const;
+	//! Returns pointable ID.
+	int32_t				getId() const;
 	//! Returns length in millimeters.
-	float			getLength() const;
+	float				getLength() const;
 	//! Returns position vector in millimeters.
-	ci::Vec3f		getPosition() const;
+	const ci::Vec3f&	getPosition() const;
 	//! Returns velocity vector in millimeters.
-	ci::Vec3f		getVelocity() const;
+	const ci::Vec3f&	getVelocity() const;
 	//! Returns width in millimeters.
-	float			getWidth() const;
+	float				getWidth() const;
 protected:
 	Pointable( const Leap::Pointable& p );
 	Pointable( const Pointable& p );
 	
+	ci::Vec3f		mDirection;
+	int32_t			mId;
+	float			mLength;
 	Leap::Pointable	mPointable;
+	ci::Vec3f		mPosition;
+	ci::Vec3f		mVelocity;
+	float			mWidth;
 	
 	friend class	Device;
 	friend class	Hand;
 	friend class	Listener;
 	friend class	Screen;
 	
+	friend Frame			LeapSdk::fromFrameSnapshot( const FrameSnapshot& s );
 	friend Finger			LeapSdk::fromLeapFinger( const Leap::Finger& f );
 	friend Leap::Finger		LeapSdk::toLeapFinger( const Finger& f );
 	friend Pointable		LeapSdk::fromLeapPointable( const Leap::Pointable& p );
@@ -162,6 +202,60 @@ namespace Gesture {
 	typedef Leap::Gesture::Type		Type;
 }
 
+/*! A Leap gesture decoded into plain values, so its properties can be 
+	read without calling into the Leap library. Values which do not 
+	apply to the gesture's type are zero. */
+struct GestureData
+{
+	GestureData();
+
+	//! Swipe and tap direction, or circle normal.
+	ci::Vec3f		mDirection;
+	//! Microseconds since the gesture started.
+	int64_t			mDuration;
+	int32_t			mId;
+	//! ID of the finger or tool making the gesture, or -1.
+	int32_t			mPointableId;
+	//! Circle center, or current swipe and tap position.
+	ci::Vec3f		mPosition;
+	//! Circle turns, or tap progress.
+	float			mProgress;
+	//! Circle radius.
+	float			mRadius;
+	//! Swipe speed.
+	float			mSpeed;
+	//! Swipe start position.
+	ci::Vec3f		mStartPosition;
+	Gesture::State	mState;
+	Gesture::Type	mType;
+};
+
+/*! Gestures in a frame, stored in place so that building and copying 
+	a frame does not allocate. Gestures beyond MAX_SIZE are dropped. */
+class GestureList
+{
+public:
+	static const size_t	MAX_SIZE	= 16;
+
+	typedef const GestureData*	const_iterator;
+
+	GestureList();
+	GestureList( const GestureList& rhs );
+	GestureList&		operator=( const GestureList& rhs );
+	const GestureData&	operator[]( size_t index ) const;
+
+	const_iterator		begin() const;
+	void				clear();
+	bool				empty() const;
+	const_iterator		end() const;
+	//! Appends \a gesture. Returns false if the list is full.
+	bool				push_back( const GestureData& gesture );
+	size_t				size() const;
+private:
+	size_t				mCount;
+	GestureData			mGestures[ MAX_SIZE ];
+};
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 //! Represents a Leap hand physical data and a collection of pointables.
@@ -172,13 +266,15 @@ public:
 	~Hand();
 
 	//! Returns normalized vector of palm face direction.
-	ci::Vec3f				getDirection() const;
+	const ci::Vec3f&		getDirection() const;
 	//! Returns map of fingers.
 	const FingerMap&		getFingers() const;
+	//! Returns hand ID.
+	int32_t					getId() const;
 	//! Returns normalized vector of palm face normal.
-	ci::Vec3f				getNormal() const;
+	const ci::Vec3f&		getNormal() const;
 	//! Returns position vector of hand in millimeters.
-	ci::Vec3f				getPosition() const;
+	const ci::Vec3f&		getPosition() const;
 	/*! The angle of rotation around the rotation axis derived from the
 		change in orientation of this hand since the first frame. */
 	float					getRotationAngle() const;
@@ -202,7 +298,7 @@ public:
 	//! The scale difference since the specified frame.
 	float					getScale( const Frame& f ) const;
 	//! Returns position vector of hand sphere in millimeters.
-	ci::Vec3f				getSpherePosition() const;
+	const ci::Vec3f&		getSpherePosition() const;
 	//! Returns radius of hand sphere in millimeters.
 	float					getSphereRadius() const;
 	//! Returns map of tools.
@@ -214,21 +310,29 @@ public:
 	 hand since the specified frame \a f. */
 	ci::Vec3f				getTranslation( const Frame& f ) const;
 	//! Returns velocity vector of hand in millimeters.
-	ci::Vec3f				getVelocity() const;
+	const ci::Vec3f&		getVelocity() const;
 private:
-	Hand( const Leap::Hand& hand, const Leap::Frame& frame );
+	Hand( const Leap::Hand& hand, const Leap::Frame& frame, uint32_t fields );
 
+	ci::Vec3f				mDirection;
 	FingerMap				mFingers;
 	Leap::Hand				mHand;
+	int32_t					mId;
+	ci::Vec3f				mNormal;
+	ci::Vec3f				mPosition;
 	float					mRotationAngle;
 	ci::Vec3f				mRotationAxis;
 	ci::Matrix44f			mRotationMatrix;
 	float					mScale;
+	ci::Vec3f				mSpherePosition;
+	float					mSphereRadius;
 	ToolMap					mTools;
 	ci::Vec3f				mTranslation;
+	ci::Vec3f				mVelocity;
 	
 	friend class			Frame;
 	
+	friend Frame			fromFrameSnapshot( const FrameSnapshot& s );
 	friend Hand				fromLeapHand( const Leap::Hand& h, const Leap::Frame& f );
 	friend Leap::Hand		toLeapHand( const Hand& h );
 };
@@ -241,11 +345,32 @@ typedef std::map<int32_t, Hand> HandMap;
 class Frame
 {
 public:
+	/*! Data read from a native frame. Combine values with '|'. Hand IDs 
+		are always read. Data which is not read keeps default values. */
+	enum Field
+	{
+		//! Hand position, direction, normal, velocity and sphere.
+		FIELD_PALM		= 0x01, 
+		//! Fingers, with tip position, direction, velocity and size.
+		FIELD_TIPS		= 0x02, 
+		//! Tools, read like fingers.
+		FIELD_TOOLS		= 0x04, 
+		//! Gestures.
+		FIELD_GESTURES	= 0x08, 
+		//! Hand rotation, scale and translation since the first frame.
+		FIELD_MOTION	= 0x10, 
+		//! Everything.
+		FIELD_ALL		= 0x1f
+	};
+
 	Frame();
 	~Frame();
 	
-	//! Returns vector of native Leap::Gesture objects.
-	const std::vector<Leap::Gesture>&	getGestures() const;
+	/*! Returns gestures decoded when the frame was created. Use 
+		toLeapFrame() to reach the native Leap::Gesture objects. */
+	const GestureList&					getGestures() const;
+	//! Returns Field values combined for the data read into this frame.
+	uint32_t							getFields() const;
 	//! Returns map of hands.
 	const HandMap&						getHands() const;
 	// Returns frame ID.
@@ -253,21 +378,76 @@ public:
 	// Return time stamp.
 	int64_t								getTimestamp() const;
 private:
-	Frame( const Leap::Frame& frame );
+	Frame( const Leap::Frame& frame, uint32_t fields = FIELD_ALL );
 	
+	uint32_t							mFields;
 	Leap::Frame							mFrame;
-	std::vector<Leap::Gesture>			mGestures;
+	GestureList							mGestures;
 	HandMap								mHands;
+	int64_t								mId;
+	int64_t								mTimestamp;
 	
+	friend class						Device;
+	friend class						DeviceSupervisor;
 	friend class						Hand;
 	friend class						Listener;
 	
+	friend Frame						LeapSdk::fromFrameSnapshot( const FrameSnapshot& s );
 	friend Frame						LeapSdk::fromLeapFrame( const Leap::Frame& f );
 	friend Leap::Frame					LeapSdk::toLeapFrame( const Frame& f );
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
+/*! Fixed-size, plain data copy of a frame. Suitable for shared memory, 
+	files and the network. Gestures, hands and pointables beyond the 
+	capacity of the snapshot are dropped. */
+struct FrameSnapshot
+{
+	static const size_t	MAX_GESTURES	= GestureList::MAX_SIZE;
+	static const size_t	MAX_HANDS		= 8;
+	static const size_t	MAX_POINTABLES	= 40;
+
+	struct HandData
+	{
+		ci::Vec3f		mDirection;
+		int32_t			mId;
+		ci::Vec3f		mNormal;
+		ci::Vec3f		mPosition;
+		float			mRotationAngle;
+		ci::Vec3f		mRotationAxis;
+		ci::Matrix44f	mRotationMatrix;
+		float			mScale;
+		ci::Vec3f		mSpherePosition;
+		float			mSphereRadius;
+		ci::Vec3f		mTranslation;
+		ci::Vec3f		mVelocity;
+	};
+
+	struct PointableData
+	{
+		ci::Vec3f		mDirection;
+		int32_t			mHandId;
+		int32_t			mId;
+		float			mLength;
+		ci::Vec3f		mPosition;
+		int32_t			mTool;
+		ci::Vec3f		mVelocity;
+		float			mWidth;
+	};
+
+	uint32_t			mGestureCount;
+	GestureData			mGestures[ MAX_GESTURES ];
+	uint32_t			mHandCount;
+	HandData			mHands[ MAX_HANDS ];
+	int64_t				mId;
+	uint32_t			mPointableCount;
+	PointableData		mPointables[ MAX_POINTABLES ];
+	int64_t				mTimestamp;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
 //! Represents a Leap calibrated screen.
 class Screen
 {
@@ -322,6 +502,544 @@ typedef std::map<int32_t, Screen> ScreenMap;
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
+/*! Uniform grid over rectangular targets, such as buttons or keys, for 
+	hit testing screen positions of pointables. Each target is stored in 
+	every cell it overlaps, so a test only checks the targets sharing the 
+	point's cell. Targets may be moved or removed at any time. */
+class HitGrid
+{
+public:
+	//! Creates grid with square cells of \a cellSize pixels.
+	HitGrid( float cellSize = 64.0f );
+
+	//! Removes all targets.
+	void			clear();
+	//! Returns cell size in pixels.
+	float			getCellSize() const;
+	//! Returns number of targets.
+	size_t			getCount() const;
+	/*! Returns ID of the target containing \a point, or -1 if there is none. 
+		Where targets overlap, the lowest ID wins. */
+	int32_t			hitTest( const ci::Vec2f& point ) const;
+	/*! Tests each point in \a points, writing one ID per point 
+		into \a ids. Returns number of points which hit a target. */
+	size_t			hitTest( const std::vector<ci::Vec2f>& points, std::vector<int32_t>* ids ) const;
+	//! Removes target \a id.
+	void			remove( int32_t id );
+	//! Adds target \a id, or moves it if it exists.
+	void			set( int32_t id, const ci::Rectf& bounds );
+	//! Sets cell size to \a cellSize pixels and rebuilds grid.
+	void			setCellSize( float cellSize );
+private:
+	struct Target
+	{
+		ci::Rectf	mBounds;
+		int32_t		mId;
+	};
+	typedef std::unordered_map<uint64_t, std::vector<Target> > CellMap;
+	
+	void			erase( int32_t id, const ci::Rectf& bounds );
+	void			insert( int32_t id, const ci::Rectf& bounds );
+	int32_t			toCell( float v ) const;
+	static uint64_t	toKey( int32_t x, int32_t y );
+	
+	CellMap			mCells;
+	float			mCellSize;
+	std::map<int32_t, ci::Rectf>	mTargets;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Spatial index over the palm and tip positions in a frame, for 
+	finding the points nearest a position or within a radius of it. 
+	Frames with a few points are searched with a linear scan over packed 
+	coordinates. Larger ones, such as frames with several hands, are 
+	indexed with a k-d tree. Memory is reused between builds. */
+class FrameIndex
+{
+public:
+	//! Kinds of point to index.
+	enum PointType
+	{
+		POINT_TYPE_FINGER = 1, POINT_TYPE_PALM = 2, POINT_TYPE_TOOL = 4, 
+		POINT_TYPE_ALL = 7
+	};
+
+	//! A point found by a query.
+	struct Match
+	{
+		//! Distance from the query position in millimeters.
+		float		mDistance;
+		int32_t		mHandId;
+		//! Finger or tool ID, or -1 for a palm.
+		int32_t		mId;
+		ci::Vec3f	mPosition;
+		PointType	mType;
+	};
+
+	FrameIndex();
+
+	/*! Indexes points in \a frame. \a types combines PointType values 
+		selecting which points to index. */
+	void			build( const Frame& frame, uint32_t types = POINT_TYPE_ALL );
+	//! Removes all points.
+	void			clear();
+	/*! Writes up to \a count points nearest to \a position into \a matches, 
+		nearest first. Returns number of points found. */
+	size_t			findNearest( const ci::Vec3f& position, size_t count, 
+								std::vector<Match>* matches ) const;
+	/*! Writes all points within \a radius of \a position into \a matches, 
+		nearest first. Returns number of points found. */
+	size_t			findWithinRadius( const ci::Vec3f& position, float radius, 
+									 std::vector<Match>* matches ) const;
+	//! Returns number of indexed points.
+	size_t			getCount() const;
+	//! Returns true if points are indexed with a k-d tree.
+	bool			isTree() const;
+private:
+	void			add( const ci::Vec3f& position, int32_t handId, int32_t id, PointType type );
+	void			insert( size_t index, float distance, size_t count, std::vector<Match>* matches ) const;
+	void			searchNearest( size_t begin, size_t end, const ci::Vec3f& position, 
+								  size_t count, std::vector<Match>* matches ) const;
+	void			searchRadius( size_t begin, size_t end, const ci::Vec3f& position, 
+								 float radius, std::vector<Match>* matches ) const;
+	void			split( size_t begin, size_t end );
+
+	// Node axes, in the order of mPoints. A node is the middle 
+	// point of its range, and its children split either half.
+	std::vector<uint8_t>	mAxes;
+	std::vector<Match>		mPoints;
+	bool					mTree;
+	std::vector<float>		mX;
+	std::vector<float>		mY;
+	std::vector<float>		mZ;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Gives fingers and tools IDs which survive Leap reassigning its own, 
+	as it does when a finger briefly drops out. Each track follows one 
+	pointable with a constant velocity Kalman filter. Pointables keep 
+	the track they had in the previous frame. The rest are assigned to 
+	the nearest predicted track within a gate, closest pairs first, and 
+	any left over start new tracks. A track without a pointable coasts 
+	on its prediction until it expires. The track table is allocated 
+	once, so updating does not allocate memory. */
+class PointableTracker
+{
+public:
+	//! A pointable followed across frames.
+	struct Track
+	{
+		/*! Position variance, position and velocity covariance, and 
+			velocity variance. Shared by all three axes. */
+		float		mCovariance[ 3 ];
+		int32_t		mHandId;
+		//! Stable track ID.
+		int32_t		mId;
+		//! Number of frames since the track was last measured.
+		uint32_t	mMissed;
+		//! ID of the pointable in the last frame, or -1 when coasting.
+		int32_t		mPointableId;
+		//! Filtered position in millimeters.
+		ci::Vec3f	mPosition;
+		//! Time stamp of the last measurement.
+		int64_t		mTimestamp;
+		bool		mTool;
+		//! Filtered velocity in millimeters per second.
+		ci::Vec3f	mVelocity;
+	};
+
+	//! Creates tracker following up to \a capacity pointables at once.
+	PointableTracker( size_t capacity = 64 );
+
+	//! Returns maximum number of tracks.
+	size_t						getCapacity() const;
+	//! Returns maximum time in microseconds a track coasts without a pointable.
+	int64_t						getCoastTime() const;
+	//! Returns distance in millimeters within which pointables join a track.
+	float						getGateDistance() const;
+	/*! Returns ID of the track following pointable \a pointableId in the 
+		last frame, or -1 if there is none. */
+	int32_t						getTrackId( int32_t pointableId ) const;
+	//! Returns tracks, including those which are coasting.
+	const std::vector<Track>&	getTracks() const;
+	//! Removes all tracks.
+	void						reset();
+	/*! Sets maximum time in microseconds a track coasts without a 
+		pointable before it is removed. Default is 250000. */
+	void						setCoastTime( int64_t microseconds );
+	/*! Sets distance in millimeters between a pointable and a track's 
+		predicted position within which they may be associated. Default 
+		is 40. */
+	void						setGateDistance( float distance );
+	/*! Sets standard deviations of unmodelled acceleration, in 
+		millimeters per second squared, and of measured positions, in 
+		millimeters. Higher acceleration follows sudden moves more 
+		closely. Higher measurement noise smooths more. Defaults are 
+		5000 and 1.5. */
+	void						setNoise( float acceleration, float measurement );
+	/*! Associates pointables in \a frame with tracks. Does nothing if 
+		\a frame was already tracked, i.e., it has the ID and time stamp 
+		of the last frame. Interpolated frames share the ID of the frame 
+		they are nearest, so they are told apart by time. */
+	void						update( const Frame& frame );
+private:
+	struct Measurement
+	{
+		int32_t		mHandId;
+		int32_t		mId;
+		ci::Vec3f	mPosition;
+		bool		mTool;
+		int32_t		mTrack;
+		ci::Vec3f	mVelocity;
+	};
+
+	struct Pair
+	{
+		float		mDistance;
+		uint32_t	mMeasurement;
+		uint32_t	mTrack;
+	};
+
+	void						add( const Pointable& p, int32_t handId, bool tool );
+	void						assign( uint32_t track, uint32_t measurement );
+
+	float						mAccelerationNoise;
+	std::vector<bool>			mAssigned;
+	size_t						mCapacity;
+	int64_t						mCoastTime;
+	int64_t						mFrameId;
+	float						mGateDistance;
+	float						mMeasurementNoise;
+	std::vector<Measurement>	mMeasurements;
+	int32_t						mNextId;
+	std::vector<Pair>			mPairs;
+	int64_t						mTimestamp;
+	std::vector<Track>			mTracks;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Fixed-length description of a hand's pose, for pose classifiers and 
+	logging. Positions and angles are measured in palm space, so they do 
+	not change as the hand moves or turns. Values are scaled to lie 
+	roughly between -1 and 1. Fingers are ordered from left to right 
+	across the palm. Values of missing fingers are zero. */
+struct HandDescriptor
+{
+	static const size_t	MAX_FINGERS	= 5;
+	//! Number of values. The last values are padding and always zero.
+	static const size_t	SIZE		= 32;
+
+	// Offsets of features in mValues
+	//! Number of fingers divided by MAX_FINGERS.
+	static const size_t	FINGER_COUNT		= 0;
+	//! Sphere radius divided by 100mm.
+	static const size_t	SPHERE_RADIUS		= 1;
+	//! Palm speed in meters per second.
+	static const size_t	PALM_SPEED			= 2;
+	//! Mean fingertip speed relative to the palm, in meters per second.
+	static const size_t	FINGER_SPEED		= 3;
+	//! Fingertip x, y and z in palm space, divided by 100mm.
+	static const size_t	FINGER_POSITIONS	= 4;
+	//! Angles between neighbouring fingers' directions, divided by pi.
+	static const size_t	FINGER_ANGLES		= 19;
+	//! Fingertip speeds relative to the palm, in meters per second.
+	static const size_t	FINGER_SPEEDS		= 23;
+
+	HandDescriptor();
+	//! Describes \a hand.
+	explicit HandDescriptor( const Hand& hand );
+
+	/*! Describes up to \a count hands in \a frame into \a descriptors. 
+		Returns number of hands described. */
+	static size_t	create( const Frame& frame, HandDescriptor* descriptors, size_t count );
+
+	//! Returns squared Euclidean distance between descriptors.
+	float			distanceSquared( const HandDescriptor& d ) const;
+	//! Describes \a hand, replacing all values.
+	void			set( const Hand& hand );
+
+	int32_t			mHandId;
+	float			mValues[ SIZE ];
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Classifies static hand poses by letting the labelled examples nearest 
+	a HandDescriptor vote. The built-in model recognizes an open hand, a 
+	fist, pointing and pinching. Custom poses are added as examples, 
+	e.g., descriptors of recorded frames, and models are saved to and 
+	loaded from small binary files. Classifying does not allocate memory. */
+class PoseClassifier
+{
+public:
+	//! Built-in poses. Custom poses use IDs from POSE_CUSTOM up.
+	enum Pose
+	{
+		POSE_UNKNOWN = -1, POSE_OPEN_HAND, POSE_FIST, POSE_POINT, POSE_PINCH, 
+		POSE_CUSTOM = 16
+	};
+
+	//! Largest number of examples which may vote.
+	static const size_t	MAX_K = 16;
+
+	//! Pose of one hand.
+	struct Result
+	{
+		//! Share of the votes won by the pose, from 0 to 1.
+		float		mConfidence;
+		//! Descriptor distance to the nearest example.
+		float		mDistance;
+		int32_t		mHandId;
+		//! Pose ID, or POSE_UNKNOWN if no example is near enough.
+		int32_t		mPose;
+	};
+
+	//! Creates classifier with the built-in model, letting \a k examples vote.
+	PoseClassifier( size_t k = 5 );
+
+	//! Adds example \a descriptor of pose \a pose.
+	void			addExample( int32_t pose, const HandDescriptor& descriptor );
+	//! Removes all examples.
+	void			clear();
+	//! Classifies hand described by \a descriptor.
+	Result			classify( const HandDescriptor& descriptor ) const;
+	/*! Classifies up to \a count hands in \a frame into \a results. 
+		Returns number of hands classified. */
+	size_t			classify( const Frame& frame, Result* results, size_t count ) const;
+	//! Returns number of examples.
+	size_t			getExampleCount() const;
+	//! Returns number of examples which vote.
+	size_t			getK() const;
+	//! Returns distance beyond which the nearest example is not trusted.
+	float			getMaxDistance() const;
+	/*! Replaces model with one written by save(). Returns false, leaving 
+		the model unchanged, if \a data is not a valid model. */
+	bool			load( const void* data, size_t size );
+	//! Replaces model with one written by save().
+	bool			load( ci::DataSourceRef source );
+	//! Replaces model with the built-in one.
+	void			loadDefault();
+	//! Appends model to \a buffer.
+	void			save( std::vector<uint8_t>* buffer ) const;
+	//! Sets number of examples which vote, up to MAX_K.
+	void			setK( size_t k );
+	/*! Sets descriptor distance beyond which the nearest example is not 
+		trusted and the pose is unknown. Default is 1.5. */
+	void			setMaxDistance( float distance );
+private:
+	struct Example
+	{
+		HandDescriptor	mDescriptor;
+		int32_t			mPose;
+	};
+
+	void					addDefault( int32_t pose, float sphereRadius, const ci::Vec3f* tips, 
+										const ci::Vec3f* directions, size_t count );
+	
+	std::vector<Example>	mExamples;
+	size_t					mK;
+	float					mMaxDistance;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Lock-free ring buffer for passing values from exactly one producer 
+	thread to exactly one consumer thread. Holds up to \a N values. */
+template<typename T, size_t N>
+class RingBuffer
+{
+public:
+	RingBuffer()
+	{
+		mRead	= 0;
+		mWrite	= 0;
+	}
+
+	//! Returns true if no values are waiting.
+	bool	empty() const
+	{
+		return mRead.load( std::memory_order_acquire ) == mWrite.load( std::memory_order_acquire );
+	}
+	/*! Removes the oldest value and copies it to \a value. Returns false 
+		if the buffer is empty. Call from the consumer thread only. */
+	bool	pop( T* value )
+	{
+		size_t read = mRead.load( std::memory_order_relaxed );
+		if ( read == mWrite.load( std::memory_order_acquire ) ) {
+			return false;
+		}
+		*value = mValues[ read % N ];
+		mRead.store( read + 1, std::memory_order_release );
+		return true;
+	}
+	/*! Copies \a value into the buffer. Returns false if the buffer is 
+		full. Call from the producer thread only. */
+	bool	push( const T& value )
+	{
+		size_t write = mWrite.load( std::memory_order_relaxed );
+		if ( write - mRead.load( std::memory_order_acquire ) >= N ) {
+			return false;
+		}
+		mValues[ write % N ] = value;
+		mWrite.store( write + 1, std::memory_order_release );
+		return true;
+	}
+private:
+	std::atomic<size_t>	mRead;
+	T					mValues[ N ];
+	std::atomic<size_t>	mWrite;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Records spans of frame pipeline work to a trace file in the Chrome 
+	trace event format, which chrome://tracing and Perfetto can open. 
+	Each thread writes to its own lock-free buffer, and a background 
+	thread appends buffered spans to the file. While tracing is stopped, 
+	a span costs one atomic load. */
+class Tracer
+{
+public:
+	/*! Starts writing spans to a new file at \a path, stopping any trace 
+		in progress. Buffers claimed by threads in earlier traces are 
+		released, so threads which have exited do not use them up. A 
+		device's threads release theirs as soon as the device is 
+		destroyed. Returns false if the file cannot be opened. */
+	static bool		start( const std::string& path );
+	/*! Writes remaining spans and the number of spans dropped, as the 
+		"Spans dropped" counter, and closes the file. */
+	static void		stop();
+
+	/*! Returns number of spans lost because a thread's buffer was full, 
+		or more threads traced than there are buffers. */
+	static uint64_t	getEventsDropped();
+	//! Returns true while a trace is being written.
+	static bool		isEnabled();
+};
+
+/*! Records the time from its construction to its destruction as a 
+	span named \a name, which must be a string literal or otherwise 
+	outlive the trace. A non-negative \a argument is written with the 
+	span as "id". */
+class TraceSpan
+{
+public:
+	TraceSpan( const char* name, int64_t argument = -1 );
+	~TraceSpan();
+private:
+	int64_t		mArgument;
+	const char*	mName;
+	int64_t		mStart;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Typed copy of the controller's configuration, so that code can read 
+	settings without a string-keyed SDK call each time. Values the 
+	controller does not report keep their defaults. Text files hold one 
+	"key = value" line per setting, using the controller's key names. */
+struct ConfigSnapshot
+{
+	//! Creates snapshot holding the default values.
+	ConfigSnapshot();
+
+	/*! Reads values from \a text. Unknown keys, blank lines and lines 
+		starting with '#' are skipped. Returns false and leaves the 
+		snapshot unchanged if a value cannot be parsed. */
+	bool		load( const std::string& text );
+	//! Reads values from a text file in \a source.
+	bool		load( ci::DataSourceRef source );
+	//! Writes every value to \a text in the format load() reads.
+	void		save( std::string* text ) const;
+
+	bool		operator==( const ConfigSnapshot& rhs ) const;
+	bool		operator!=( const ConfigSnapshot& rhs ) const;
+
+	//! Minimum arc of a circle gesture, in radians.
+	float		mCircleMinArc;
+	//! Minimum radius of a circle gesture, in millimeters.
+	float		mCircleMinRadius;
+	//! Time window for detecting a key tap, in seconds.
+	float		mKeyTapHistorySeconds;
+	//! Minimum distance of a key tap, in millimeters.
+	float		mKeyTapMinDistance;
+	//! Minimum downward speed of a key tap, in millimeters per second.
+	float		mKeyTapMinDownVelocity;
+	//! Time window for detecting a screen tap, in seconds.
+	float		mScreenTapHistorySeconds;
+	//! Minimum distance of a screen tap, in millimeters.
+	float		mScreenTapMinDistance;
+	//! Minimum forward speed of a screen tap, in millimeters per second.
+	float		mScreenTapMinForwardVelocity;
+	//! Minimum length of a swipe gesture, in millimeters.
+	float		mSwipeMinLength;
+	//! Minimum speed of a swipe gesture, in millimeters per second.
+	float		mSwipeMinVelocity;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Counters describing frame flow through a Device since it was created 
+	or its statistics were last reset. Each value is read atomically, but 
+	values are not read at one instant, so totals may differ slightly 
+	from each other while frames are arriving. */
+struct DeviceStats
+{
+	//! Time spent in one frame callback.
+	struct CallbackStats
+	{
+		//! Returns mean time per call in microseconds.
+		double		getAverageTime() const;
+
+		//! Number of calls.
+		uint64_t	mCalls;
+		//! Callback ID returned by Device::addCallback().
+		uint32_t	mId;
+		//! Longest call in microseconds.
+		int64_t		mMaxTime;
+		//! Total time in microseconds.
+		int64_t		mTime;
+	};
+
+	DeviceStats();
+
+	//! Returns mean number of hands per delivered frame.
+	double		getAverageHands() const;
+	//! Returns mean number of fingers and tools per delivered frame.
+	double		getAveragePointables() const;
+	//! Returns mean time update() waited for the frame lock, in microseconds.
+	double		getAverageLockWaitTime() const;
+
+	//! Frame callbacks, ordered by ID.
+	std::vector<CallbackStats>	mCallbacks;
+	//! Frames passed to update callbacks.
+	uint64_t	mFramesDelivered;
+	/*! Frames discarded because a newer frame arrived before update() 
+		or the worker thread was ready for it. */
+	uint64_t	mFramesDropped;
+	//! Frames reported by the controller.
+	uint64_t	mFramesReceived;
+	/*! Tracking rate in frames per second, measured from the IDs and 
+		timestamps of delivered frames. Frames dropped between deliveries 
+		are still counted. */
+	float		mFrameRate;
+	//! Sum of hands in delivered frames.
+	uint64_t	mHandCount;
+	//! Number of times update() locked the frame.
+	uint64_t	mLockCount;
+	//! Longest time update() waited for the frame lock, in microseconds.
+	int64_t		mLockMaxWaitTime;
+	//! Total time update() waited for the frame lock, in microseconds.
+	int64_t		mLockWaitTime;
+	//! Sum of fingers and tools in delivered frames.
+	uint64_t	mPointableCount;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
 //! Receives and manages Leap controller data.
 class Listener : public Leap::Listener
 {
@@ -333,15 +1051,26 @@ protected:
     virtual void	onFrame( const Leap::Controller& controller );
 	virtual void	onInit( const Leap::Controller& controller );
 	
-	volatile bool	mConnected;
-	volatile bool	mExited;
-	volatile bool	mFirstFrameReceived;
-	volatile bool	mInitialized;
-	std::mutex		*mMutex;
-	volatile bool	mNewFrame;
+	std::condition_variable	*mCondition;
+	Device					*mDevice;
+	std::atomic<bool>		mFirstFrameReceived;
+	std::atomic<bool>		mInitialized;
+	std::mutex				*mMutex;
+	bool					mNewFrame;
+	bool					mPipelined;
+
+	// Connection state is written here and by the stall check in 
+	// Device::update(). Transitions made here are queued for update().
+	std::atomic<int64_t>	mFrameTime;
+	std::atomic<int32_t>	mState;
+	RingBuffer<int32_t, 16>	mTransitions;
+	void					setState( int32_t state );
 
-	Frame			mFirstFrame;
-	Frame			mFrame;
+	Frame					mFirstFrame;
+	Frame					mFrame;
+	RingBuffer<Leap::Frame, 4>	mPendingFrames;
+	// Leap callback thread, whose trace buffer is released with the device
+	std::atomic<size_t>		mTraceOwner;
 
 	friend class	Device;
 };
@@ -354,11 +1083,54 @@ typedef std::shared_ptr<class Device> DeviceRef;
 class Device
 {
 public:
-	//! Creates and returns device instance.
-	static DeviceRef	create();
+	//! Connection state of the controller.
+	enum State
+	{
+		//! Waiting for the controller to connect.
+		STATE_INITIALIZING, 
+		//! Connected, but no frame has arrived yet.
+		STATE_CONNECTED, 
+		//! Frames are arriving.
+		STATE_STREAMING, 
+		//! Connected, but no frame has arrived within the stall time.
+		STATE_STALLED, 
+		//! The controller has disconnected.
+		STATE_DISCONNECTED, 
+		//! The Leap application has exited.
+		STATE_EXITED
+	};
+
+	/*! Selects the thread on which a frame callback runs. Callbacks 
+		may be added and removed only from the thread that owns the 
+		device, regardless of where they run. */
+	enum CallbackThread
+	{
+		/*! Runs inside update(), on the thread that calls it. Receives at 
+			most one frame per update. Safe to touch application state. */
+		CALLBACK_THREAD_UPDATE, 
+		/*! Runs on the thread that converts the frame -- Leap's own thread,
+			or the worker thread when the device is pipelined -- as soon as 
+			the frame is ready. Receives every frame. Must return quickly, 
+			as tracking waits for it, and must synchronize any state it 
+			shares with other threads. */
+		CALLBACK_THREAD_TRACKING, 
+		/*! Runs on a dispatch thread owned by the device, in frame order. 
+			Neither tracking nor update() waits for it. Frames are dropped 
+			if the callback falls sixteen frames behind. Must synchronize 
+			any state it shares with other threads. */
+		CALLBACK_THREAD_WORKER
+	};
+
+	/*! Creates and returns device instance. Set \a pipelined to true to 
+		convert frames on a dedicated worker thread. The Leap thread only 
+		hands native frames to the worker, and update() only delivers 
+		frames the worker has finished. Default is false. */
+	static DeviceRef	create( bool pipelined = false );
 	~Device();
 	
-	//! Must be called to trigger frame events.
+	/*! Must be called to trigger frame events. Delivers at most one 
+		frame per call. Use a FrameQueue to choose which frames a 
+		consumer receives. */
 	void				update();
 
 	//! Enable a specific type of gesture. 
@@ -369,29 +1141,111 @@ public:
 	/*! Returns a LEAP::Config object, which you can use to query the Leap 
 		system for configuration information. */
 	Leap::Config		getConfig() const;
+	/*! Returns configuration read when the controller connected, or by the 
+		last call to refreshConfig(). */
+	const ConfigSnapshot&	getConfigSnapshot() const;
+	/*! Returns a frame interpolated between the two most recent frames 
+		at \a timestamp, in microseconds on the clock of Frame::getTimestamp(). 
+		Times outside the two frames are clamped to the nearer one. Frames 
+		are recorded from the first call on, and an empty frame is returned 
+		until one has arrived. The result has no native Leap frame, so the 
+		motion methods taking a frame do not apply to it. */
+	Frame				getInterpolatedFrame( int64_t timestamp );
+	/*! Returns a frame interpolated 15ms before getTimestamp(), so that 
+		render time falls between the two most recent frames. */
+	Frame				getInterpolatedFrame();
 	//! Return map of calibrated screens.
 	const ScreenMap&	getScreens() const;
+	/*! Returns time in microseconds without frames after which a 
+		streaming device is stalled. */
+	int64_t				getStallTime() const;
+	/*! Returns connection state. A streaming device reports it has 
+		stalled as soon as the stall time passes, even before update() 
+		notifies state callbacks. Safe to call from any thread. */
+	State				getState() const;
+	/*! Returns frame counters and timings. Safe to call from any 
+		thread. */
+	DeviceStats			getStats() const;
+	/*! Returns current time on the clock of Frame::getTimestamp(), estimated 
+		from the arrival times of recorded frames. Subtract a little more than 
+		one frame period to render between the two most recent frames. */
+	int64_t				getTimestamp() const;
+	/*! Sets time in microseconds without frames after which a streaming 
+		device is stalled. Default is 250000. */
+	void				setStallTime( int64_t microseconds );
+	//! Sets all statistics to zero.
+	void				resetStats();
 	
 	//! Returns true if the device has exited.
 	bool				hasExited() const;
-	//! Returns true if the device is connected.
+	/*! Returns true if the device is connected, whether or not 
+		frames are arriving. */
 	bool				isConnected() const;
 	//! Returns true if LEAP application is initialized.
 	bool				isInitialized() const;
+	//! Returns true if frames are converted on a worker thread.
+	bool				isPipelined() const;
+
+	/*! Reads configuration from the controller. Config callbacks are 
+		notified if it changed. Called by update() after the controller 
+		connects. */
+	void				refreshConfig();
 
 	/*! Adds frame event callback. \a callback has the signature \a void(Frame). 
-		\a callbackObject is the instance receiving the event. Returns callback ID. */
+		\a callbackObject is the instance receiving the event. \a thread selects 
+		where the callback runs. \a fields combines Frame::Field values for 
+		the data the callback reads. Frames are converted with the data 
+		every callback asked for, so a callback may find more than it 
+		asked for, but never less. Returns callback ID. */
 	template<typename T, typename Y> 
-	inline uint32_t		addCallback( T callback, Y *callbackObject )
+	inline uint32_t		addCallback( T callback, Y *callbackObject, 
+									CallbackThread thread = CALLBACK_THREAD_UPDATE, 
+									uint32_t fields = Frame::FIELD_ALL )
 	{
 		uint32_t id = mCallbacks.empty() ? 0 : mCallbacks.rbegin()->first + 1;
-		mCallbacks.insert( std::make_pair( id, CallbackRef( new Callback( mSignal.connect( std::bind( callback, callbackObject, std::placeholders::_1 ) ) ) ) ) );
+		mCallbackFields[ id ] = fields;
+		updateFields();
+		std::function<void ( Frame )> fn = timeCallback( id, std::bind( callback, callbackObject, std::placeholders::_1 ) );
+		Callback connection;
+		switch ( thread ) {
+		case CALLBACK_THREAD_TRACKING:
+			connection = mSignalTracking.connect( fn );
+			break;
+		case CALLBACK_THREAD_WORKER:
+			startDispatch();
+			connection = mSignalWorker.connect( fn );
+			break;
+		default:
+			connection = mSignal.connect( fn );
+			break;
+		}
+		mCallbacks.insert( std::make_pair( id, CallbackRef( new Callback( connection ) ) ) );
+		return id;
+	}
+	/*! Adds connection state callback. \a callback has the signature 
+		\a void(Device::State). \a callbackObject is the instance receiving 
+		the event. Runs on the thread calling update(). Returns callback ID. */
+	template<typename T, typename Y> 
+	inline uint32_t		addStateCallback( T callback, Y *callbackObject )
+	{
+		uint32_t id = mCallbacks.empty() ? 0 : mCallbacks.rbegin()->first + 1;
+		mCallbacks.insert( std::make_pair( id, CallbackRef( new Callback( mSignalState.connect( std::bind( callback, callbackObject, std::placeholders::_1 ) ) ) ) ) );
+		return id;
+	}
+	/*! Adds configuration change callback. \a callback has the signature 
+		\a void(ConfigSnapshot). \a callbackObject is the instance receiving 
+		the event. Runs on the thread calling update(). Returns callback ID. */
+	template<typename T, typename Y> 
+	inline uint32_t		addConfigCallback( T callback, Y *callbackObject )
+	{
+		uint32_t id = mCallbacks.empty() ? 0 : mCallbacks.rbegin()->first + 1;
+		mCallbacks.insert( std::make_pair( id, CallbackRef( new Callback( mSignalConfig.connect( std::bind( callback, callbackObject, std::placeholders::_1 ) ) ) ) ) );
 		return id;
 	}
 	//! Remove callback by ID.
 	void				removeCallback( uint32_t id );
 private:
-	Device();
+	Device( bool pipelined );
 
 	typedef boost::signals2::connection		Callback;
 	typedef std::shared_ptr<Callback>		CallbackRef;
@@ -399,13 +1253,822 @@ private:
 
 	CallbackList							mCallbacks;
 	boost::signals2::signal<void ( Frame )>	mSignal;
+	boost::signals2::signal<void ( Frame )>	mSignalTracking;
+	boost::signals2::signal<void ( Frame )>	mSignalWorker;
+	boost::signals2::signal<void ( ConfigSnapshot )>	mSignalConfig;
+	boost::signals2::signal<void ( State )>				mSignalState;
 	
+	ConfigSnapshot		mConfig;
+	std::atomic<bool>	mConfigPending;
 	Leap::Controller*	mController;
 	Listener			mListener;
 	std::mutex			mMutex;
 	ScreenMap			mScreens;
+
+	// Connection state last passed to state callbacks
+	State				mNotifiedState;
+	std::atomic<int64_t>	mStallTime;
+	void				notifyState( State state );
+
+	// Pipeline
+	std::condition_variable		mCondition;
+	RingBuffer<Frame, 4>		mFrames;
+	std::atomic<bool>			mRunning;
+	std::shared_ptr<std::thread>	mThread;
+	std::mutex					mThreadMutex;
+	void						process();
+
+	// Delivery to tracking and worker callbacks
+	std::condition_variable		mDispatchCondition;
+	RingBuffer<Frame, 16>		mDispatchFrames;
+	std::mutex					mDispatchMutex;
+	std::atomic<bool>			mDispatchRunning;
+	std::shared_ptr<std::thread>	mDispatchThread;
+	void						dispatch( const Frame& frame );
+	bool						isDispatching() const;
+	void						runDispatch();
+	void						startDispatch();
+
+	// Two most recent frames for interpolation
+	FrameSnapshot				mHistory[ 2 ];
+	uint64_t					mHistoryCount;
+	mutable std::mutex			mHistoryMutex;
+	int64_t						mHistoryOffset;
+	std::atomic<bool>			mRecording;
+	void						record( const Frame& frame );
+
+	// Statistics. Counters are updated with relaxed atomics on whichever 
+	// thread does the work. Only adding or removing a callback locks.
+	struct CallbackCounter
+	{
+		std::atomic<uint64_t>	mCalls;
+		std::atomic<int64_t>	mMaxTime;
+		std::atomic<int64_t>	mTime;
+	};
+	typedef std::shared_ptr<CallbackCounter>			CallbackCounterRef;
+	typedef std::map<uint32_t, CallbackCounterRef>		CallbackCounterMap;
+
+	CallbackCounterMap			mCallbackCounters;
+	std::atomic<uint64_t>		mFramesDelivered;
+	std::atomic<uint64_t>		mFramesDropped;
+	std::atomic<uint64_t>		mFramesReceived;
+	std::atomic<float>			mFrameRate;
+	std::atomic<uint64_t>		mHandCount;
+	int64_t						mLastDeliveredId;
+	int64_t						mLastDeliveredTimestamp;
+	std::atomic<uint64_t>		mLockCount;
+	std::atomic<int64_t>		mLockMaxWaitTime;
+	std::atomic<int64_t>		mLockWaitTime;
+	std::atomic<uint64_t>		mPointableCount;
+	mutable std::mutex			mStatsMutex;
+	void						deliver( const Frame& frame );
+
+	// Data read from native frames, combined for all frame callbacks
+	std::map<uint32_t, uint32_t>	mCallbackFields;
+	std::atomic<uint32_t>			mFields;
+	uint32_t						getFields() const;
+	void							updateFields();
+	std::function<void ( Frame )>	timeCallback( uint32_t id, const std::function<void ( Frame )>& callback );
+
+	friend class				Listener;
+};
+	
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::shared_ptr<class FrameQueue> FrameQueueRef;
+
+/*! Passes frames from a producer to a consumer that may run at a 
+	different rate, deciding which frames the consumer sees by policy. 
+	Register push() as a tracking callback on a Device so that it 
+	receives every frame, then call update() or pop() from the consuming 
+	thread. Give each consumer its own queue. push() never locks or 
+	waits. Frames are held as snapshots, so their hands, pointables and 
+	gestures are limited to the capacity of a FrameSnapshot. */
+class FrameQueue
+{
+public:
+	enum Policy
+	{
+		//! Delivers the newest frame and drops any older ones.
+		POLICY_LATEST, 
+		/*! Delivers the first frame pushed since the last delivery and 
+			drops any newer ones. */
+		POLICY_OLDEST, 
+		/*! Delivers every frame in order. Frames are only dropped when 
+			the queue is full. */
+		POLICY_QUEUE, 
+		/*! Delivers the newest frame with hand and pointable positions 
+			and velocities averaged over the frames skipped since the last 
+			delivery. */
+		POLICY_MERGE, 
+		/*! Delivers frames at a fixed rate in frame time, interpolated 
+			between the frames on either side of each tick. */
+		POLICY_RESAMPLE
+	};
+
+	/*! Creates a queue delivering frames by \a policy and holding up 
+		to \a capacity frames. */
+	static FrameQueueRef	create( Policy policy = POLICY_LATEST, size_t capacity = 16 );
+	~FrameQueue();
+
+	//! Delivers waiting frames to callbacks. Call from the consumer thread.
+	void				update();
+
+	//! Returns maximum number of frames held.
+	size_t				getCapacity() const;
+	//! Returns number of frames the consumer never received.
+	uint64_t			getFramesDropped() const;
+	//! Returns delivery policy.
+	Policy				getPolicy() const;
+	//! Returns rate of POLICY_RESAMPLE in frames per second.
+	float				getRate() const;
+	//! Sets rate of POLICY_RESAMPLE in frames per second. Default is 30.
+	void				setRate( float rate );
+
+	/*! Copies the next frame for the consumer into \a snapshot. Returns 
+		false if no frame is due. Call from the consumer thread only. */
+	bool				pop( FrameSnapshot* snapshot );
+	/*! Adds \a frame to the queue. Call from the producer thread only. 
+		Never blocks. */
+	void				push( Frame frame );
+
+	/*! Adds frame event callback. \a callback has the signature \a void(Frame). 
+		\a callbackObject is the instance receiving the event. Returns callback ID. */
+	template<typename T, typename Y> 
+	inline uint32_t		addCallback( T callback, Y *callbackObject )
+	{
+		uint32_t id = mCallbacks.empty() ? 0 : mCallbacks.rbegin()->first + 1;
+		mCallbacks.insert( std::make_pair( id, CallbackRef( new Callback( mSignal.connect( std::bind( callback, callbackObject, std::placeholders::_1 ) ) ) ) ) );
+		return id;
+	}
+	//! Remove callback by ID.
+	void				removeCallback( uint32_t id );
+private:
+	FrameQueue( Policy policy, size_t capacity );
+
+	typedef boost::signals2::connection		Callback;
+	typedef std::shared_ptr<Callback>		CallbackRef;
+	typedef std::map<uint32_t, CallbackRef>	CallbackList;
+
+	CallbackList							mCallbacks;
+	boost::signals2::signal<void ( Frame )>	mSignal;
+
+	// Each slot is guarded by a sequence lock, as the producer 
+	// overwrites unread frames under some policies
+	struct Slot
+	{
+		std::atomic<uint32_t>	mSequence;
+		FrameSnapshot			mFrame;
+	};
+
+	bool					merge( FrameSnapshot* snapshot );
+	bool					readSlot( uint64_t index, FrameSnapshot* snapshot );
+	bool					resample( FrameSnapshot* snapshot );
+
+	std::atomic<uint64_t>	mDropped;
+	Policy					mPolicy;
+	std::atomic<uint64_t>	mReadCount;
+	std::vector<Slot>		mSlots;
+	std::atomic<uint64_t>	mWriteCount;
+
+	// Consumer state
+	bool					mHasNext;
+	bool					mHasPrevious;
+	FrameSnapshot			mNext;
+	FrameSnapshot			mPrevious;
+	float					mRate;
+	FrameSnapshot			mScratch;
+	FrameSnapshot			mSnapshot;
+	int64_t					mTick;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/*! Passes each frame's gestures to handlers registered by gesture 
+	type. Handlers may be limited to a screen region, tested against the 
+	gesture's position through a projection set by the application. 
+	Routing the same frame again does nothing. 
+	A gesture's start and stop are delivered once, even if several 
+	frames report them. Updates are delivered once per frame. */
+class GestureRouter
+{
+public:
+	GestureRouter();
+
+	/*! Adds handler for gestures of \a type. \a callback has the signature 
+		\a void(const GestureData&). \a callbackObject is the instance 
+		receiving the event. Returns handler ID. */
+	template<typename T, typename Y> 
+	inline uint32_t		addHandler( Gesture::Type type, T callback, Y *callbackObject )
+	{
+		return addHandler( type, std::bind( callback, callbackObject, std::placeholders::_1 ) );
+	}
+	/*! Adds handler for gestures of \a type whose projected position is 
+		inside \a region. Where regions overlap, only the handler added 
+		first receives the gesture. Returns handler ID. */
+	template<typename T, typename Y> 
+	inline uint32_t		addHandler( Gesture::Type type, const ci::Rectf& region, 
+									T callback, Y *callbackObject )
+	{
+		return addHandler( type, region, 
+			std::bind( callback, callbackObject, std::placeholders::_1 ) );
+	}
+	//! Adds handler function receiving all gestures of \a type. Returns handler ID.
+	uint32_t			addHandler( Gesture::Type type, 
+									const std::function<void ( const GestureData& )>& handler );
+	/*! Adds handler function for gestures inside \a region. A region 
+		with zero width and height receives all gestures of \a type. 
+		Returns handler ID. */
+	uint32_t			addHandler( Gesture::Type type, const ci::Rectf& region, 
+									const std::function<void ( const GestureData& )>& handler );
+	//! Remove handler by ID.
+	void				removeHandler( uint32_t id );
+
+	/*! Calls the handlers of the gestures in \a frame. Handlers must 
+		not add or remove handlers. */
+	void				route( const Frame& frame );
+	/*! Sets function mapping a gesture position in Leap space to the 
+		space of handler regions, typically window pixels. */
+	void				setProjection( const std::function<ci::Vec2f ( const ci::Vec3f& )>& projection );
+private:
+	typedef std::function<void ( const GestureData& )>	Handler;
+	
+	// Handlers for one gesture type
+	struct Route
+	{
+		std::vector<std::pair<uint32_t, Handler> >	mHandlers;
+		std::map<uint32_t, Handler>					mRegionHandlers;
+		HitGrid										mRegions;
+	};
+	
+	// Last state routed per gesture ID
+	struct State
+	{
+		Gesture::State	mState;
+		int64_t			mTimestamp;
+	};
+
+	int64_t									mFrameId;
+	uint32_t								mNextId;
+	std::function<ci::Vec2f ( const ci::Vec3f& )>	mProjection;
+	std::map<int32_t, Route>				mRoutes;
+	std::map<int32_t, State>				mStates;
 };
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::shared_ptr<class SharedMemoryPublisher> SharedMemoryPublisherRef;
+
+/*! Writes frames into a named shared memory ring buffer so that other 
+	processes can read them through a SharedMemorySubscriber. Each slot 
+	is guarded by a sequence lock, so the writer never waits for readers. 
+	Register publish() as a device callback, or call it directly with 
+	frames from any other source. */
+class SharedMemoryPublisher
+{
+public:
+	/*! Creates a publisher writing to shared memory named \a name with 
+		\a slotCount frame slots. Throws ExcSharedMemory if shared memory 
+		with this name already exists, so that two publishers never write 
+		to the same slots. Set \a replace to true to remove an existing 
+		region first, e.g., one left behind by a publisher that crashed. 
+		Readers of the old region keep it until they close it. Windows 
+		removes a region when its last user closes it, so \a replace has 
+		no effect there. */
+	static SharedMemoryPublisherRef	create( const std::string& name, size_t slotCount = 8, bool replace = false );
+	~SharedMemoryPublisher();
+
+	//! Returns shared memory name.
+	const std::string&	getName() const;
+	//! Writes \a frame to the next slot. Call from one thread at a time.
+	void				publish( Frame frame );
+private:
+	SharedMemoryPublisher( const std::string& name, size_t slotCount, bool replace );
+
+	void*				mData;
+	void*				mHandle;
+	std::string			mName;
+	size_t				mSize;
+};
+
+typedef std::shared_ptr<class SharedMemorySubscriber> SharedMemorySubscriberRef;
+
+/*! Reads frames written by a SharedMemoryPublisher in another process. 
+	Delivers frames through callbacks in update(), like a Device. */
+class SharedMemorySubscriber
+{
+public:
+	//! Creates a subscriber reading shared memory named \a name.
+	static SharedMemorySubscriberRef	create( const std::string& name );
+	~SharedMemorySubscriber();
+
+	//! Must be called to trigger frame events.
+	void				update();
+
+	//! Returns shared memory name.
+	const std::string&	getName() const;
+	/*! Copies the newest frame into \a snapshot. Returns false if no 
+		frame has been published since the last read. */
+	bool				read( FrameSnapshot* snapshot );
+
+	/*! Adds frame event callback. \a callback has the signature \a void(Frame). 
+		\a callbackObject is the instance receiving the event. Returns callback ID. */
+	template<typename T, typename Y> 
+	inline uint32_t		addCallback( T callback, Y *callbackObject )
+	{
+		uint32_t id = mCallbacks.empty() ? 0 : mCallbacks.rbegin()->first + 1;
+		mCallbacks.insert( std::make_pair( id, CallbackRef( new Callback( mSignal.connect( std::bind( callback, callbackObject, std::placeholders::_1 ) ) ) ) ) );
+		return id;
+	}
+	//! Remove callback by ID.
+	void				removeCallback( uint32_t id );
+private:
+	SharedMemorySubscriber( const std::string& name );
+
+	typedef boost::signals2::connection		Callback;
+	typedef std::shared_ptr<Callback>		CallbackRef;
+	typedef std::map<uint32_t, CallbackRef>	CallbackList;
+
+	CallbackList							mCallbacks;
+	boost::signals2::signal<void ( Frame )>	mSignal;
+
+	void*				mData;
+	void*				mHandle;
+	std::string			mName;
+	uint64_t			mReadCount;
+	size_t				mSize;
+	uint32_t			mSlotCount;
+	FrameSnapshot		mSnapshot;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+//! Quantization and delta state shared by FrameEncoder and FrameDecoder.
+class FrameCodec
+{
+public:
+	FrameCodec();
+
+	//! Forgets the previous frame. The next frame is coded as a key frame.
+	void				reset();
+protected:
+	static const size_t	GESTURE_VALUES		= 12;
+	static const size_t	HAND_VALUES			= 24;
+	static const size_t	POINTABLE_VALUES	= 11;
+
+	// Fixed-point copy of a snapshot. Deltas are taken between these
+	// so encoder and decoder share exactly the same reference.
+	struct QuantizedFrame
+	{
+		uint32_t		mGestureCount;
+		int64_t			mGestureDurations[ FrameSnapshot::MAX_GESTURES ];
+		int32_t			mGestureIds[ FrameSnapshot::MAX_GESTURES ];
+		int32_t			mGesturePointables[ FrameSnapshot::MAX_GESTURES ];
+		int32_t			mGestures[ FrameSnapshot::MAX_GESTURES ][ GESTURE_VALUES ];
+		int8_t			mGestureStates[ FrameSnapshot::MAX_GESTURES ];
+		int8_t			mGestureTypes[ FrameSnapshot::MAX_GESTURES ];
+		uint32_t		mHandCount;
+		int32_t			mHandIds[ FrameSnapshot::MAX_HANDS ];
+		int32_t			mHands[ FrameSnapshot::MAX_HANDS ][ HAND_VALUES ];
+		int64_t			mId;
+		uint32_t		mPointableCount;
+		uint32_t		mPointableHands[ FrameSnapshot::MAX_POINTABLES ];
+		int32_t			mPointableIds[ FrameSnapshot::MAX_POINTABLES ];
+		int32_t			mPointables[ FrameSnapshot::MAX_POINTABLES ][ POINTABLE_VALUES ];
+		uint8_t			mPointableTools[ FrameSnapshot::MAX_POINTABLES ];
+		int64_t			mTimestamp;
+	};
+
+	static void			dequantize( const QuantizedFrame& q, FrameSnapshot* s );
+	static void			quantize( const FrameSnapshot& s, QuantizedFrame* q );
+
+	bool				mHasPrevious;
+	QuantizedFrame		mPrevious;
+	uint32_t			mSequence;
+};
+
+/*! Encodes frame snapshots into a compact byte stream. Values are quantized 
+	to fixed point (0.1mm for positions) and each hand and pointable is 
+	delta coded against the same ID in the previous frame. Gestures are 
+	short lived and coded without deltas. Key frames are coded without a 
+	reference so a decoder can join the stream at any time. */
+class FrameEncoder : public FrameCodec
+{
+public:
+	/*! Appends \a s to \a buffer. Set \a keyFrame to true to code it 
+		without reference to the previous frame. */
+	void	encode( const FrameSnapshot& s, bool keyFrame, std::vector<uint8_t>* buffer );
+};
+
+//! Decodes frames written by a FrameEncoder.
+class FrameDecoder : public FrameCodec
+{
+public:
+	/*! Decodes the frame at \a offset in \a data of \a size bytes into \a s 
+		and moves \a offset past it. Returns false if the frame can not be 
+		decoded because the frame it was delta coded against was missed, or 
+		if the data is malformed. */
+	bool	decode( const uint8_t* data, size_t size, size_t* offset, FrameSnapshot* s );
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+//! Transport used to stream frames.
+enum StreamProtocol
+{
+	STREAM_PROTOCOL_TCP, STREAM_PROTOCOL_UDP
+};
+
+typedef std::shared_ptr<class FrameServer> FrameServerRef;
+
+/*! Streams encoded frames to FrameClient instances over the network. 
+	Frames are batched into packets of up to getBatchSize() frames. 
+	Register publish() as a device callback, or call it directly. */
+class FrameServer
+{
+public:
+	//! Creates a server listening on \a port.
+	static FrameServerRef	create( uint16_t port, StreamProtocol protocol = STREAM_PROTOCOL_UDP );
+	~FrameServer();
+
+	//! Returns number of frames sent in each packet.
+	size_t				getBatchSize() const;
+	//! Returns total bytes sent to all clients.
+	uint64_t			getBytesSent() const;
+	//! Returns number of frames between key frames.
+	size_t				getKeyFrameInterval() const;
+	/*! Sets number of frames sent in each packet. Default is 2. A packet 
+		is sent early if another frame would make it too large for one 
+		datagram. */
+	void				setBatchSize( size_t count );
+	//! Sets number of frames between key frames. Default is 120.
+	void				setKeyFrameInterval( size_t count );
+
+	//! Encodes and queues \a frame. Call from one thread at a time.
+	void				publish( Frame frame );
+private:
+	FrameServer( uint16_t port, StreamProtocol protocol );
+
+	struct Connection;
+
+	//! Sends the frames batched so far as one packet.
+	void						flush();
+	
+	size_t						mBatchCount;
+	size_t						mBatchSize;
+	std::vector<uint8_t>		mBuffer;
+	std::shared_ptr<Connection>	mConnection;
+	FrameEncoder				mEncoder;
+	std::vector<uint8_t>		mFrameBuffer;
+	size_t						mKeyFrameCount;
+	size_t						mKeyFrameInterval;
+	FrameSnapshot				mSnapshot;
+};
+
+typedef std::shared_ptr<class FrameClient> FrameClientRef;
+
+/*! Receives frames from a FrameServer and delivers them through callbacks 
+	in update(), like a Device. */
+class FrameClient
+{
+public:
+	//! Creates a client connected to server at \a host on \a port.
+	static FrameClientRef	create( const std::string& host, uint16_t port, 
+									StreamProtocol protocol = STREAM_PROTOCOL_UDP );
+	~FrameClient();
+
+	//! Must be called to trigger frame events.
+	void				update();
+
+	//! Returns total bytes received.
+	uint64_t			getBytesReceived() const;
+	//! Returns number of frames that could not be decoded.
+	uint64_t			getFramesDropped() const;
+	//! Returns number of frames decoded.
+	uint64_t			getFramesReceived() const;
+	/*! Returns average time in seconds between a packet being sent and 
+		decoded. Only meaningful when server and client share a clock, 
+		i.e., over loopback. */
+	double				getLatency() const;
+	
+	/*! Adds frame event callback. \a callback has the signature \a void(Frame). 
+		\a callbackObject is the instance receiving the event. Returns callback ID. */
+	template<typename T, typename Y> 
+	inline uint32_t		addCallback( T callback, Y *callbackObject )
+	{
+		uint32_t id = mCallbacks.empty() ? 0 : mCallbacks.rbegin()->first + 1;
+		mCallbacks.insert( std::make_pair( id, CallbackRef( new Callback( mSignal.connect( std::bind( callback, callbackObject, std::placeholders::_1 ) ) ) ) ) );
+		return id;
+	}
+	//! Remove callback by ID.
+	void				removeCallback( uint32_t id );
+private:
+	FrameClient( const std::string& host, uint16_t port, StreamProtocol protocol );
+
+	typedef boost::signals2::connection		Callback;
+	typedef std::shared_ptr<Callback>		CallbackRef;
+	typedef std::map<uint32_t, CallbackRef>	CallbackList;
+
+	CallbackList							mCallbacks;
+	boost::signals2::signal<void ( Frame )>	mSignal;
+
+	struct Connection;
+	
+	std::shared_ptr<Connection>	mConnection;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::shared_ptr<class DeviceGroup> DeviceGroupRef;
+
+/*! Fuses frames from several sources into one frame in a shared world 
+	space. Each source has a calibration matrix mapping its space to 
+	world space in millimeters. Source clocks are aligned to the host 
+	clock, and each source's newest frame is extrapolated to the time of 
+	the newest frame overall. Hands seen by more than one source are 
+	merged, weighting each copy by its closeness to the sensor which saw 
+	it. Fused hands, pointables and gestures keep their IDs from frame to 
+	frame. Fusing does not allocate memory. */
+class DeviceGroup
+{
+public:
+	//! Creates and returns device group instance.
+	static DeviceGroupRef	create();
+	~DeviceGroup();
+
+	//! Must be called to fuse frames and trigger frame events.
+	void				update();
+
+	/*! Adds \a source, which may be a Device, SharedMemorySubscriber, 
+		FrameClient or any class with the same addCallback() method. The 
+		source must still be updated by the application. \a calibration 
+		maps the source's space to world space. Returns source index. */
+	template<typename T> 
+	inline uint32_t		addSource( const std::shared_ptr<T>& source, 
+									const ci::Matrix44f& calibration = ci::Matrix44f::identity() )
+	{
+		uint32_t index	= addSource( calibration );
+		Source* s		= mSources[ index ].get();
+		uint32_t id		= source->addCallback( &Source::onFrame, s );
+		s->mDisconnect	= [ source, id ]() { source->removeCallback( id ); };
+		return index;
+	}
+	/*! Adds source whose frames are passed to push(), such as a 
+		recording or synthetic frames. Returns source index. */
+	uint32_t			addSource( const ci::Matrix44f& calibration = ci::Matrix44f::identity() );
+	//! Sets newest frame of source \a index. May be called from any thread.
+	void				push( uint32_t index, const Frame& frame );
+	//! Sets newest frame of source \a index. May be called from any thread.
+	void				push( uint32_t index, const FrameSnapshot& snapshot );
 	
+	//! Fuses the newest frame of each source into \a snapshot.
+	void				fuse( FrameSnapshot* snapshot );
+
+	//! Returns calibration matrix of source \a index.
+	ci::Matrix44f		getCalibration( uint32_t index ) const;
+	//! Returns age in microseconds after which a source's frame is ignored.
+	int64_t				getMaxAge() const;
+	//! Returns distance in millimeters within which hands are merged.
+	float				getMergeDistance() const;
+	//! Returns number of sources.
+	size_t				getSourceCount() const;
+	//! Sets calibration matrix of source \a index.
+	void				setCalibration( uint32_t index, const ci::Matrix44f& calibration );
+	/*! Sets age in microseconds, relative to the newest frame, after 
+		which a source's frame is ignored. Default is 50000. */
+	void				setMaxAge( int64_t microseconds );
+	/*! Sets distance in millimeters within which hands from different 
+		sources are merged. Fingers and tools are merged within a quarter 
+		of this distance. Default is 80. */
+	void				setMergeDistance( float distance );
+
+	/*! Adds frame event callback. \a callback has the signature \a void(Frame). 
+		\a callbackObject is the instance receiving the event. Returns callback ID. */
+	template<typename T, typename Y> 
+	inline uint32_t		addCallback( T callback, Y *callbackObject )
+	{
+		uint32_t id = mCallbacks.empty() ? 0 : mCallbacks.rbegin()->first + 1;
+		mCallbacks.insert( std::make_pair( id, CallbackRef( new Callback( mSignal.connect( std::bind( callback, callbackObject, std::placeholders::_1 ) ) ) ) ) );
+		return id;
+	}
+	//! Remove callback by ID.
+	void				removeCallback( uint32_t id );
+private:
+	DeviceGroup();
+
+	typedef boost::signals2::connection		Callback;
+	typedef std::shared_ptr<Callback>		CallbackRef;
+	typedef std::map<uint32_t, CallbackRef>	CallbackList;
+
+	CallbackList							mCallbacks;
+	boost::signals2::signal<void ( Frame )>	mSignal;
+
+	// Maps a source's IDs to fused IDs
+	template<size_t N> 
+	struct IdMap
+	{
+		IdMap();
+
+		void			add( int32_t id, int32_t fusedId );
+		int32_t			find( int32_t id ) const;
+
+		uint32_t		mCount;
+		int32_t			mFusedIds[ N ];
+		int32_t			mIds[ N ];
+	};
+
+	struct Source
+	{
+		Source( DeviceGroup* group, uint32_t index );
+
+		// Updates clock offset for a new frame
+		void			align( int64_t clock );
+		void			onFrame( Frame frame );
+
+		ci::Matrix44f							mCalibration;
+		std::function<void ()>					mDisconnect;
+		FrameSnapshot							mFrame;
+		IdMap<FrameSnapshot::MAX_GESTURES>		mGestureIds;
+		DeviceGroup*							mGroup;
+		IdMap<FrameSnapshot::MAX_HANDS>			mHandIds;
+		bool									mHasFrame;
+		uint32_t								mIndex;
+		bool									mNew;
+		int64_t									mOffset;
+		IdMap<FrameSnapshot::MAX_POINTABLES>	mPointableIds;
+	};
+
+	void				merge( uint32_t index, float age, FrameSnapshot* s );
+
+	int64_t				mFrameId;
+	int64_t				mMaxAge;
+	float				mMergeDistance;
+	mutable std::mutex	mMutex;
+	int32_t				mNextGestureId;
+	int32_t				mNextHandId;
+	int32_t				mNextPointableId;
+	FrameSnapshot		mSnapshot;
+	std::vector<std::shared_ptr<Source> >	mSources;
+
+	// Weight and last contributing source of each fused hand and pointable
+	uint32_t			mHandSources[ FrameSnapshot::MAX_HANDS ];
+	float				mHandWeights[ FrameSnapshot::MAX_HANDS ];
+	uint32_t			mPointableSources[ FrameSnapshot::MAX_POINTABLES ];
+	float				mPointableWeights[ FrameSnapshot::MAX_POINTABLES ];
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef std::shared_ptr<class DeviceSupervisor> DeviceSupervisorRef;
+
+/*! Keeps frames coming when a device stalls, disconnects or exits. 
+	Owns a primary Device and delivers its frames while it streams. 
+	Once the primary is no longer streaming, which for a stall takes the 
+	device's stall time (250ms by default), the next update() switches 
+	to a standby source if one is streaming, or to a fallback generated 
+	from recent frames. It switches back as soon as the primary streams 
+	again. A primary which has exited, disconnected or stalled for the 
+	reconnect time is replaced with a new Device, waiting twice as long 
+	after each attempt that fails, up to a minute. A primary which never 
+	connected is left alone, as Leap connects it once a controller is 
+	plugged in. Every frame delivered gets a new ID and time stamp, so 
+	that both increase across switches. Within a source, time stamps 
+	advance as the source's do. */
+class DeviceSupervisor
+{
+public:
+	//! Frames delivered when neither the primary nor the standby streams.
+	enum Fallback
+	{
+		//! Loops the primary's recent frames at their recorded pace.
+		FALLBACK_REPLAY, 
+		//! Shows one open hand swaying slowly.
+		FALLBACK_IDLE, 
+		//! Delivers nothing.
+		FALLBACK_NONE
+	};
+
+	//! Source of the frames being delivered.
+	enum Source
+	{
+		SOURCE_PRIMARY, SOURCE_STANDBY, SOURCE_REPLAY, SOURCE_IDLE, SOURCE_NONE
+	};
+
+	/*! Creates a supervisor with a primary device. \a pipelined is passed 
+		to Device::create(). \a historySize is the number of recent frames 
+		kept for replay. */
+	static DeviceSupervisorRef	create( bool pipelined = false, size_t historySize = 120 );
+	~DeviceSupervisor();
+
+	//! Must be called to update sources and trigger frame events.
+	void				update();
+
+	/*! Sets \a standby, which may be a Device, SharedMemorySubscriber, 
+		FrameClient or any class with the same addCallback() and update() 
+		methods. The standby stays subscribed and is updated by the 
+		supervisor, so it is ready the moment the primary fails. */
+	template<typename T> 
+	inline void			setStandby( const std::shared_ptr<T>& standby )
+	{
+		clearStandby();
+		uint32_t id			= standby->addCallback( &DeviceSupervisor::onStandbyFrame, this );
+		mStandbyDisconnect	= [ standby, id ]() { standby->removeCallback( id ); };
+		mStandbyUpdate		= [ standby ]() { standby->update(); };
+	}
+	//! Removes standby source.
+	void				clearStandby();
+
+	//! Returns primary device. Changes when the device is replaced.
+	const DeviceRef&	getDevice() const;
+	//! Returns frames delivered when no source streams.
+	Fallback			getFallback() const;
+	//! Returns number of recent frames kept for replay.
+	size_t				getHistorySize() const;
+	/*! Returns time in microseconds after which a primary which is not 
+		connected is replaced. */
+	int64_t				getReconnectTime() const;
+	//! Returns source of the frames being delivered.
+	Source				getSource() const;
+	//! Sets frames delivered when no source streams. Default is FALLBACK_REPLAY.
+	void				setFallback( Fallback fallback );
+	/*! Sets time in microseconds after which a primary which is not 
+		connected is first replaced. Default is 5000000. */
+	void				setReconnectTime( int64_t microseconds );
+
+	/*! Adds frame event callback. \a callback has the signature \a void(Frame). 
+		\a callbackObject is the instance receiving the event. Returns callback ID. */
+	template<typename T, typename Y> 
+	inline uint32_t		addCallback( T callback, Y *callbackObject )
+	{
+		uint32_t id = mCallbacks.empty() ? 0 : mCallbacks.rbegin()->first + 1;
+		mCallbacks.insert( std::make_pair( id, CallbackRef( new Callback( mSignal.connect( std::bind( callback, callbackObject, std::placeholders::_1 ) ) ) ) ) );
+		return id;
+	}
+	/*! Adds source change callback. \a callback has the signature 
+		\a void(DeviceSupervisor::Source). \a callbackObject is the instance 
+		receiving the event. Returns callback ID. */
+	template<typename T, typename Y> 
+	inline uint32_t		addSourceCallback( T callback, Y *callbackObject )
+	{
+		uint32_t id = mCallbacks.empty() ? 0 : mCallbacks.rbegin()->first + 1;
+		mCallbacks.insert( std::make_pair( id, CallbackRef( new Callback( mSignalSource.connect( std::bind( callback, callbackObject, std::placeholders::_1 ) ) ) ) ) );
+		return id;
+	}
+	//! Remove callback by ID.
+	void				removeCallback( uint32_t id );
+private:
+	DeviceSupervisor( bool pipelined, size_t historySize );
+
+	typedef boost::signals2::connection		Callback;
+	typedef std::shared_ptr<Callback>		CallbackRef;
+	typedef std::map<uint32_t, CallbackRef>	CallbackList;
+
+	CallbackList							mCallbacks;
+	boost::signals2::signal<void ( Frame )>		mSignal;
+	boost::signals2::signal<void ( Source )>	mSignalSource;
+
+	void					connect();
+	void					deliver( Frame frame );
+	void					onFrame( Frame frame );
+	void					onStandbyFrame( Frame frame );
+	void					replay( FrameSnapshot* snapshot ) const;
+
+	// Primary. Replacement is attempted mReconnectDelay after the 
+	// primary last streamed or was replaced.
+	uint32_t				mCallbackId;
+	int64_t					mConnectTime;
+	DeviceRef				mDevice;
+	Frame					mFrame;
+	bool					mNewFrame;
+	bool					mPipelined;
+
+	// Standby
+	std::function<void ()>	mStandbyDisconnect;
+	Frame					mStandbyFrame;
+	int64_t					mStandbyTime;
+	std::function<void ()>	mStandbyUpdate;
+	bool					mNewStandbyFrame;
+
+	// Recent primary frames, oldest first from mHistoryCount
+	std::vector<FrameSnapshot>	mHistory;
+	uint64_t				mHistoryCount;
+
+	// Delivered frames continue from the last frame delivered, whatever 
+	// its source. mSourceTimestamp is the last delivered frame's own time 
+	// stamp, or -1 if the source has changed since.
+	int64_t					mClock;
+	int64_t					mDeliverTime;
+	Fallback				mFallback;
+	int64_t					mFallbackTime;
+	int64_t					mId;
+	int64_t					mReconnectDelay;
+	int64_t					mReconnectTime;
+	FrameSnapshot			mSnapshot;
+	Source					mSource;
+	int64_t					mSourceTimestamp;
+	int64_t					mTimestamp;
+};
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 //! Base class for LeapSdk exceptions.
@@ -413,6 +2076,44 @@ class Exception : public cinder::Exception
 {
 };
 
+//! Exception expressing failure to create or open shared memory.
+class ExcSharedMemory : public Exception {
+public:
+	ExcSharedMemory( const std::string& name, bool exists = false ) throw()
+	{
+		mMessage = "Unable to open shared memory \"" + name + "\"" + ( exists ? ", it is already in use." : "." );
+	}
+	~ExcSharedMemory() throw()
+	{
+	}
+
+	virtual const char* what() const throw()
+	{
+		return mMessage.c_str();
+	}
+private:
+	std::string mMessage;
+};
+
+//! Exception expressing failure to open a frame stream.
+class ExcStream : public Exception {
+public:
+	ExcStream( const std::string& message ) throw()
+	{
+		mMessage = "Unable to open frame stream: " + message;
+	}
+	~ExcStream() throw()
+	{
+	}
+
+	virtual const char* what() const throw()
+	{
+		return mMessage.c_str();
+	}
+private:
+	std::string mMessage;
+};
+
 //! Exception expressing inability to locate a calibrated screen near a pointable.
 class ExcNoClosestScreen : public Exception {
 public:
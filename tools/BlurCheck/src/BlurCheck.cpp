@@ -0,0 +1,138 @@
+/*
+* 
+* Copyright (c) 2013, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+*/
+
+// Checks the TracerApp sample's BlurChain kernel on the CPU. Each tap 
+// count's kernel must sum to one, and BlurChain::blur(), which reads 
+// pairs of texels with linear filtering like the shader, must match a 
+// direct convolution with the discrete Gaussian the kernel was folded 
+// from. Needs no window or GL context. Build with 
+// samples/TracerApp/src/BlurChain.cpp and samples/TracerApp/include on 
+// the include path, and link Cinder and OpenGL.
+//
+// Usage: BlurCheck [width] [height]
+
+#include "BlurChain.h"
+#include "cinder/CinderMath.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace ci;
+using namespace std;
+
+static const int32_t	kChannels	= 3;
+static const float		kTolerance	= 0.0001f;
+
+// Returns the discrete Gaussian, from the center out, that 
+// BlurChain::createKernel() folds into paired reads
+static vector<float> createGaussian( size_t taps )
+{
+	size_t radius	= ( math<size_t>::max( taps, 1 ) - 1 ) / 2 * 2;
+	float sigma		= (float)( radius + 1 ) / 3.0f;
+	vector<float> gaussian( radius + 1 );
+	float sum = 0.0f;
+	for ( size_t i = 0; i <= radius; ++i ) {
+		gaussian[ i ]	= math<float>::exp( -(float)( i * i ) / ( 2.0f * sigma * sigma ) );
+		sum				+= i == 0 ? gaussian[ i ] : gaussian[ i ] * 2.0f;
+	}
+	for ( size_t i = 0; i <= radius; ++i ) {
+		gaussian[ i ] /= sum;
+	}
+	return gaussian;
+}
+
+// Convolves one axis texel by texel, clamping at the edges
+static void convolve( const float* source, float* destination, int32_t width, int32_t height, 
+					 const vector<float>& gaussian, int32_t axis )
+{
+	int32_t radius = (int32_t)gaussian.size() - 1;
+	for ( int32_t y = 0; y < height; ++y ) {
+		for ( int32_t x = 0; x < width; ++x ) {
+			for ( int32_t c = 0; c < kChannels; ++c ) {
+				float value = 0.0f;
+				for ( int32_t i = -radius; i <= radius; ++i ) {
+					int32_t sx	= axis == 0 ? math<int32_t>::clamp( x + i, 0, width - 1 ) : x;
+					int32_t sy	= axis == 1 ? math<int32_t>::clamp( y + i, 0, height - 1 ) : y;
+					value		+= source[ ( sy * width + sx ) * kChannels + c ] * gaussian[ math<int32_t>::abs( i ) ];
+				}
+				destination[ ( y * width + x ) * kChannels + c ] = value;
+			}
+		}
+	}
+}
+
+int main( int argc, char** argv )
+{
+	int32_t width	= argc > 1 ? math<int32_t>::max( atoi( argv[ 1 ] ), 1 ) : 64;
+	int32_t height	= argc > 2 ? math<int32_t>::max( atoi( argv[ 2 ] ), 1 ) : 48;
+	
+	size_t count = (size_t)( width * height * kChannels );
+	vector<float> image( count );
+	srand( 1 );
+	for ( size_t i = 0; i < count; ++i ) {
+		image[ i ] = (float)rand() / (float)RAND_MAX;
+	}
+	vector<float> blurred( count );
+	vector<float> expected( count );
+
+	bool passed = true;
+	for ( size_t taps = 1; taps <= 31; taps += 2 ) {
+		vector<float> offsets;
+		vector<float> weights;
+		BlurChain::createKernel( taps, &offsets, &weights );
+		float sum = weights[ 0 ];
+		for ( size_t i = 1; i < weights.size(); ++i ) {
+			sum += weights[ i ] * 2.0f;
+		}
+
+		vector<float> gaussian	= createGaussian( taps );
+		float error				= 0.0f;
+		for ( int32_t axis = 0; axis < 2; ++axis ) {
+			BlurChain::blur( &image[ 0 ], &blurred[ 0 ], width, height, kChannels, taps, axis );
+			convolve( &image[ 0 ], &expected[ 0 ], width, height, gaussian, axis );
+			for ( size_t i = 0; i < count; ++i ) {
+				error = math<float>::max( error, math<float>::abs( blurred[ i ] - expected[ i ] ) );
+			}
+		}
+
+		bool ok	= math<float>::abs( sum - 1.0f ) < kTolerance && error < kTolerance;
+		passed	= passed && ok;
+		printf( "%2u taps over %2u texels: weight sum %.6f, max error %.7f %s\n", 
+			(uint32_t)taps, (uint32_t)( gaussian.size() * 2 - 1 ), sum, error, ok ? "" : "FAILED" );
+	}
+	printf( passed ? "Passed\n" : "Failed\n" );
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,276 @@
+/*
+* 
+* Copyright (c) 2013, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+*/
+
+// Records hand poses from the controller, builds a PoseClassifier model 
+// from the recordings and reports how accurately a model classifies 
+// them. A recording is a file of frames written by FrameEncoder.
+//
+// Usage:
+//   PoseTrainer record <file> [seconds]
+//     Records frames with hands from the controller into <file>.
+//   PoseTrainer train <model> <pose>:<file> [<pose>:<file> ...]
+//     Builds a model from every hand in the recordings, labelled with 
+//     the pose ID before each file, and saves it to <model>. The last 
+//     fifth of each recording is held out and used to report accuracy.
+//   PoseTrainer evaluate <model|default> <pose>:<file> [...]
+//     Reports accuracy of a saved model, or the built-in one, on every 
+//     hand in the recordings.
+
+#include "Cinder-LeapSdk.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace LeapSdk;
+using namespace std;
+
+// The last fifth of each recording is held out of training. Frames next 
+// to each other are nearly identical, so holding out frames from 
+// throughout a recording would overstate accuracy.
+static const size_t kHoldOutDivisor		= 5;
+static const size_t kKeyFrameInterval	= 120;
+
+struct Sample
+{
+	HandDescriptor	mDescriptor;
+	size_t			mFrame;
+	bool			mHeldOut;
+	int32_t			mPose;
+};
+
+static bool readFile( const string& path, vector<uint8_t>* data )
+{
+	ifstream file( path.c_str(), ios::binary );
+	if ( !file ) {
+		return false;
+	}
+	data->assign( istreambuf_iterator<char>( file ), istreambuf_iterator<char>() );
+	return true;
+}
+
+static bool writeFile( const string& path, const vector<uint8_t>& data )
+{
+	ofstream file( path.c_str(), ios::binary );
+	file.write( (const char*)( data.empty() ? 0 : &data[ 0 ] ), data.size() );
+	return file.good();
+}
+
+// Reads the hands in "pose:file" arguments from argv[ first ] on
+static bool readSamples( int argc, char** argv, int first, vector<Sample>* samples )
+{
+	for ( int i = first; i < argc; ++i ) {
+		string arg		= argv[ i ];
+		size_t colon	= arg.find( ':' );
+		if ( colon == string::npos ) {
+			printf( "Expected <pose>:<file>, got \"%s\"\n", arg.c_str() );
+			return false;
+		}
+		int32_t pose	= atoi( arg.substr( 0, colon ).c_str() );
+		string path		= arg.substr( colon + 1 );
+		vector<uint8_t> data;
+		if ( !readFile( path, &data ) ) {
+			printf( "Unable to read \"%s\"\n", path.c_str() );
+			return false;
+		}
+
+		FrameDecoder decoder;
+		FrameSnapshot snapshot;
+		HandDescriptor descriptors[ FrameSnapshot::MAX_HANDS ];
+		size_t frameCount	= 0;
+		size_t offset		= 0;
+		size_t sampleCount	= samples->size();
+		while ( offset < data.size() ) {
+			if ( !decoder.decode( &data[ 0 ], data.size(), &offset, &snapshot ) ) {
+				printf( "\"%s\" is damaged after %u frames\n", path.c_str(), (uint32_t)frameCount );
+				break;
+			}
+			size_t count = HandDescriptor::create( fromFrameSnapshot( snapshot ), descriptors, FrameSnapshot::MAX_HANDS );
+			for ( size_t j = 0; j < count; ++j ) {
+				Sample sample;
+				sample.mDescriptor	= descriptors[ j ];
+				sample.mFrame		= frameCount;
+				sample.mHeldOut		= false;
+				sample.mPose		= pose;
+				samples->push_back( sample );
+			}
+			++frameCount;
+		}
+		for ( size_t j = sampleCount; j < samples->size(); ++j ) {
+			Sample& sample	= ( *samples )[ j ];
+			sample.mHeldOut	= sample.mFrame >= frameCount - frameCount / kHoldOutDivisor;
+		}
+		printf( "Pose %d: %u hands in %u frames from \"%s\"\n", pose, 
+			(uint32_t)( samples->size() - sampleCount ), (uint32_t)frameCount, path.c_str() );
+	}
+	return !samples->empty();
+}
+
+// Prints accuracy per pose and overall. Returns share classified correctly.
+static float report( const PoseClassifier& classifier, const vector<Sample>& samples )
+{
+	map<int32_t, pair<size_t, size_t> > poses;
+	size_t correct = 0;
+	size_t unknown = 0;
+	for ( vector<Sample>::const_iterator iter = samples.begin(); iter != samples.end(); ++iter ) {
+		PoseClassifier::Result result = classifier.classify( iter->mDescriptor );
+		pair<size_t, size_t>& counts = poses[ iter->mPose ];
+		++counts.second;
+		if ( result.mPose == iter->mPose ) {
+			++counts.first;
+			++correct;
+		} else if ( result.mPose == PoseClassifier::POSE_UNKNOWN ) {
+			++unknown;
+		}
+	}
+	for ( map<int32_t, pair<size_t, size_t> >::const_iterator iter = poses.begin(); iter != poses.end(); ++iter ) {
+		printf( "  Pose %3d: %5.1f%% of %u\n", iter->first, 
+			100.0f * iter->second.first / (float)iter->second.second, (uint32_t)iter->second.second );
+	}
+	float accuracy = samples.empty() ? 0.0f : correct / (float)samples.size();
+	printf( "  Overall:  %5.1f%% of %u, %u unknown\n", 100.0f * accuracy, 
+		(uint32_t)samples.size(), (uint32_t)unknown );
+	return accuracy;
+}
+
+class Recorder
+{
+public:
+	void onFrame( Frame frame )
+	{
+		if ( frame.getHands().empty() ) {
+			return;
+		}
+		toFrameSnapshot( frame, &mSnapshot );
+		mEncoder.encode( mSnapshot, mFrameCount % kKeyFrameInterval == 0, &mData );
+		++mFrameCount;
+	}
+
+	vector<uint8_t>	mData;
+	FrameEncoder	mEncoder;
+	size_t			mFrameCount;
+	FrameSnapshot	mSnapshot;
+};
+
+static int32_t record( const string& path, double duration )
+{
+	Recorder recorder;
+	recorder.mFrameCount = 0;
+	DeviceRef device = Device::create();
+	device->addCallback( &Recorder::onFrame, &recorder );
+
+	printf( "Hold the pose over the controller. Recording for %.0f seconds.\n", duration );
+	chrono::steady_clock::time_point end = chrono::steady_clock::now() + 
+		chrono::microseconds( (int64_t)( duration * 1000000.0 ) );
+	while ( chrono::steady_clock::now() < end ) {
+		device->update();
+		this_thread::sleep_for( chrono::milliseconds( 5 ) );
+	}
+
+	if ( !writeFile( path, recorder.mData ) ) {
+		printf( "Unable to write \"%s\"\n", path.c_str() );
+		return 1;
+	}
+	printf( "Recorded %u frames with hands\n", (uint32_t)recorder.mFrameCount );
+	return recorder.mFrameCount > 0 ? 0 : 1;
+}
+
+static int32_t train( const string& path, const vector<Sample>& samples )
+{
+	PoseClassifier classifier;
+	classifier.clear();
+	vector<Sample> heldOut;
+	for ( vector<Sample>::const_iterator iter = samples.begin(); iter != samples.end(); ++iter ) {
+		if ( iter->mHeldOut ) {
+			heldOut.push_back( *iter );
+		} else {
+			classifier.addExample( iter->mPose, iter->mDescriptor );
+		}
+	}
+	printf( "Trained on %u hands. Held out:\n", (uint32_t)classifier.getExampleCount() );
+	report( classifier, heldOut );
+
+	// Keep the held out hands in the saved model
+	for ( vector<Sample>::const_iterator iter = heldOut.begin(); iter != heldOut.end(); ++iter ) {
+		classifier.addExample( iter->mPose, iter->mDescriptor );
+	}
+	vector<uint8_t> data;
+	classifier.save( &data );
+	if ( !writeFile( path, data ) ) {
+		printf( "Unable to write \"%s\"\n", path.c_str() );
+		return 1;
+	}
+	printf( "Saved %u examples to \"%s\"\n", (uint32_t)classifier.getExampleCount(), path.c_str() );
+	return 0;
+}
+
+static int32_t evaluate( const string& path, const vector<Sample>& samples )
+{
+	PoseClassifier classifier;
+	if ( path != "default" ) {
+		vector<uint8_t> data;
+		if ( !readFile( path, &data ) || data.empty() || !classifier.load( &data[ 0 ], data.size() ) ) {
+			printf( "\"%s\" is not a pose model\n", path.c_str() );
+			return 1;
+		}
+	}
+	printf( "Model with %u examples:\n", (uint32_t)classifier.getExampleCount() );
+	report( classifier, samples );
+	return 0;
+}
+
+int main( int argc, char** argv )
+{
+	string command = argc > 1 ? argv[ 1 ] : "";
+	if ( command == "record" && argc > 2 ) {
+		return record( argv[ 2 ], argc > 3 ? atof( argv[ 3 ] ) : 10.0 );
+	}
+	if ( ( command == "train" || command == "evaluate" ) && argc > 3 ) {
+		vector<Sample> samples;
+		if ( !readSamples( argc, argv, 3, &samples ) ) {
+			return 1;
+		}
+		return command == "train" ? train( argv[ 2 ], samples ) : evaluate( argv[ 2 ], samples );
+	}
+	printf( "Usage: PoseTrainer record <file> [seconds]\n" );
+	printf( "       PoseTrainer train <model> <pose>:<file> [<pose>:<file> ...]\n" );
+	printf( "       PoseTrainer evaluate <model|default> <pose>:<file> [...]\n" );
+	return 1;
+}
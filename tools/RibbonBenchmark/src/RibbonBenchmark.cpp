@@ -0,0 +1,102 @@
+/*
+* 
+* Copyright (c) 2013, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+*/
+
+// Times the TracerApp sample's Ribbon with 1,000 and 10,000 points per 
+// ribbon. Each round fills a ribbon, then ages it and writes its 
+// vertices once per update, as the sample does each frame. Needs no 
+// window or GL context. Build with samples/TracerApp/src/Ribbon.cpp 
+// and samples/TracerApp/include on the include path.
+//
+// Usage: RibbonBenchmark [rounds]
+
+#include "Ribbon.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace ci;
+using namespace std;
+
+static const size_t kUpdatesPerRound = 120;
+
+// Returns average microseconds per update and per write
+static void run( size_t pointCount, int32_t roundCount, double* updateTime, double* writeTime )
+{
+	Ribbon ribbon( 0, Colorf::white(), pointCount );
+	vector<RibbonVertex> vertices( pointCount * 2 + 2 );
+	
+	chrono::steady_clock::duration updating	= chrono::steady_clock::duration::zero();
+	chrono::steady_clock::duration writing	= chrono::steady_clock::duration::zero();
+	size_t written = 0;
+	for ( int32_t round = 0; round < roundCount; ++round ) {
+		ribbon.reset( 0, Colorf::white() );
+		for ( size_t i = 0; i < pointCount; ++i ) {
+			ribbon.addPoint( Vec3f( (float)i, (float)( i % 7 ), 0.0f ), 5.0f + (float)( i % 50 ) );
+		}
+		for ( size_t i = 0; i < kUpdatesPerRound; ++i ) {
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			ribbon.update();
+			chrono::steady_clock::time_point updated = chrono::steady_clock::now();
+			written += ribbon.write( &vertices[ 0 ] ) - &vertices[ 0 ];
+			updating	+= updated - start;
+			writing		+= chrono::steady_clock::now() - updated;
+		}
+	}
+
+	// Keeps the writes from being optimized away
+	if ( written == 0 ) {
+		printf( "No vertices written\n" );
+	}
+	double updates	= (double)roundCount * kUpdatesPerRound;
+	*updateTime		= chrono::duration<double, micro>( updating ).count() / updates;
+	*writeTime		= chrono::duration<double, micro>( writing ).count() / updates;
+}
+
+int main( int argc, char** argv )
+{
+	int32_t roundCount = argc > 1 ? atoi( argv[ 1 ] ) : 20;
+
+	const size_t pointCounts[] = { 1000, 10000 };
+	for ( size_t i = 0; i < 2; ++i ) {
+		double updateTime	= 0.0;
+		double writeTime	= 0.0;
+		run( pointCounts[ i ], roundCount, &updateTime, &writeTime );
+		printf( "%6u points: %8.1f us per update, %8.1f us per write\n", 
+			(uint32_t)pointCounts[ i ], updateTime, writeTime );
+	}
+	return 0;
+}
@@ -0,0 +1,171 @@
+/*
+* 
+* Copyright (c) 2013, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+*/
+
+// Publishes synthetic frames through shared memory from one process 
+// and reads them back in another, checking each frame read against 
+// the frame that was published. Runs on one machine without a 
+// controller. POSIX only.
+//
+// Usage: SharedMemoryTest [frame count] [hand count]
+// Exits with 0 when every frame read matches.
+
+#include "cinder/Utilities.h"
+#include "Cinder-LeapSdk.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace ci;
+using namespace LeapSdk;
+using namespace std;
+
+static const int64_t kFramePeriod = 1000;
+
+// Compares what a reader got with the frame the publisher wrote
+static bool matches( const FrameSnapshot& a, const FrameSnapshot& b )
+{
+	if ( a.mId != b.mId || a.mTimestamp != b.mTimestamp || 
+		a.mHandCount != b.mHandCount || a.mPointableCount != b.mPointableCount ) {
+		return false;
+	}
+	for ( uint32_t i = 0; i < a.mHandCount; ++i ) {
+		if ( a.mHands[ i ].mId != b.mHands[ i ].mId || 
+			a.mHands[ i ].mPosition != b.mHands[ i ].mPosition || 
+			a.mHands[ i ].mVelocity != b.mHands[ i ].mVelocity ) {
+			return false;
+		}
+	}
+	for ( uint32_t i = 0; i < a.mPointableCount; ++i ) {
+		if ( a.mPointables[ i ].mId != b.mPointables[ i ].mId || 
+			a.mPointables[ i ].mHandId != b.mPointables[ i ].mHandId || 
+			a.mPointables[ i ].mPosition != b.mPointables[ i ].mPosition ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static int32_t subscribe( const string& name, int64_t frameCount, size_t handCount )
+{
+	SharedMemorySubscriberRef subscriber = SharedMemorySubscriber::create( name );
+
+	int64_t lastId		= 0;
+	int64_t mismatched	= 0;
+	int64_t received	= 0;
+	int64_t skipped		= 0;
+	FrameSnapshot snapshot;
+	FrameSnapshot expected;
+	chrono::steady_clock::time_point timeout = chrono::steady_clock::now() + chrono::seconds( 10 );
+	while ( lastId < frameCount && chrono::steady_clock::now() < timeout ) {
+		if ( !subscriber->read( &snapshot ) ) {
+			this_thread::yield();
+			continue;
+		}
+		synthesizeFrameSnapshot( snapshot.mId, snapshot.mId * kFramePeriod, handCount, &expected );
+		if ( !matches( snapshot, expected ) ) {
+			++mismatched;
+		}
+		if ( snapshot.mId <= lastId ) {
+			++mismatched;
+		} else {
+			skipped += snapshot.mId - lastId - 1;
+		}
+		lastId = snapshot.mId;
+		++received;
+	}
+
+	printf( "Read %lld frames, skipped %lld, %lld did not match\n", 
+		(long long)received, (long long)skipped, (long long)mismatched );
+	fflush( stdout );
+	return mismatched == 0 && lastId == frameCount ? 0 : 1;
+}
+
+int main( int argc, char** argv )
+{
+	int64_t frameCount	= argc > 1 ? atoll( argv[ 1 ] ) : 2000;
+	size_t handCount	= argc > 2 ? (size_t)atoi( argv[ 2 ] ) : 2;
+	string name			= "LeapSdkTest" + toString( getpid() );
+
+	// Create the region before forking so the reader can open it at once
+	SharedMemoryPublisherRef publisher;
+	try {
+		publisher = SharedMemoryPublisher::create( name, 8, true );
+	} catch ( const ExcSharedMemory& ex ) {
+		printf( "%s\n", ex.what() );
+		return 1;
+	}
+
+	// A second publisher must not share the first one's slots
+	try {
+		SharedMemoryPublisher::create( name );
+		printf( "Second publisher opened \"%s\"\nFailed\n", name.c_str() );
+		return 1;
+	} catch ( const ExcSharedMemory& ) {
+	}
+
+	pid_t child = fork();
+	if ( child == 0 ) {
+		try {
+			_exit( subscribe( name, frameCount, handCount ) );
+		} catch ( const ExcSharedMemory& ex ) {
+			printf( "%s\n", ex.what() );
+			fflush( stdout );
+			_exit( 1 );
+		}
+	} else if ( child < 0 ) {
+		printf( "Unable to start reader\n" );
+		return 1;
+	}
+
+	// Publish at one frame per millisecond, faster than the controller
+	FrameSnapshot snapshot;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for ( int64_t id = 1; id <= frameCount; ++id ) {
+		synthesizeFrameSnapshot( id, id * kFramePeriod, handCount, &snapshot );
+		publisher->publish( fromFrameSnapshot( snapshot ) );
+		this_thread::sleep_until( start + chrono::microseconds( id * kFramePeriod ) );
+	}
+	printf( "Published %lld frames with %u hands\n", (long long)frameCount, (uint32_t)snapshot.mHandCount );
+
+	int32_t status = 1;
+	waitpid( child, &status, 0 );
+	bool passed = WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+	printf( passed ? "Passed\n" : "Failed\n" );
+	return passed ? 0 : 1;
+}
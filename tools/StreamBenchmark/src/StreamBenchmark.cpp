@@ -0,0 +1,126 @@
+/*
+* 
+* Copyright (c) 2013, Ban the Rewind
+* All rights reserved.
+* 
+* Redistribution and use in source and binary forms, with or 
+* without modification, are permitted provided that the following 
+* conditions are met:
+* 
+* Redistributions of source code must retain the above copyright 
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright 
+* notice, this list of conditions and the following disclaimer in 
+* the documentation and/or other materials provided with the 
+* distribution.
+* 
+* Neither the name of the Ban the Rewind nor the names of its 
+* contributors may be used to endorse or promote products 
+* derived from this software without specific prior written 
+* permission.
+* 
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+*/
+
+// Streams synthetic frames from a FrameServer to a FrameClient over 
+// loopback and reports throughput, bandwidth and latency. Runs on one 
+// machine without a controller.
+//
+// Usage: StreamBenchmark [udp|tcp] [frames per second] [seconds] 
+//                        [hand count] [batch size]
+
+#include "Cinder-LeapSdk.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace LeapSdk;
+using namespace std;
+
+static const uint16_t kPort = 17000;
+
+class Receiver
+{
+public:
+	Receiver()
+		: mFrames( 0 ), mLastId( 0 ), mOutOfOrder( 0 )
+	{
+	}
+
+	// Only the newest frame is delivered on each update()
+	void onFrame( Frame frame )
+	{
+		if ( frame.getId() <= mLastId ) {
+			++mOutOfOrder;
+		}
+		mLastId = frame.getId();
+		++mFrames;
+	}
+
+	int64_t	mFrames;
+	int64_t	mLastId;
+	int64_t	mOutOfOrder;
+};
+
+int main( int argc, char** argv )
+{
+	bool tcp			= argc > 1 && strcmp( argv[ 1 ], "tcp" ) == 0;
+	double rate			= argc > 2 ? atof( argv[ 2 ] ) : 120.0;
+	double duration		= argc > 3 ? atof( argv[ 3 ] ) : 5.0;
+	size_t handCount	= argc > 4 ? (size_t)atoi( argv[ 4 ] ) : 2;
+	size_t batchSize	= argc > 5 ? (size_t)atoi( argv[ 5 ] ) : 2;
+	StreamProtocol protocol = tcp ? STREAM_PROTOCOL_TCP : STREAM_PROTOCOL_UDP;
+
+	FrameServerRef server = FrameServer::create( kPort, protocol );
+	server->setBatchSize( batchSize );
+	FrameClientRef client = FrameClient::create( "127.0.0.1", kPort, protocol );
+	Receiver receiver;
+	client->addCallback( &Receiver::onFrame, &receiver );
+
+	// Give the client time to connect or subscribe
+	this_thread::sleep_for( chrono::milliseconds( 200 ) );
+
+	int64_t frameCount	= (int64_t)( rate * duration );
+	int64_t period		= (int64_t)( 1000000.0 / rate );
+	FrameSnapshot snapshot;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for ( int64_t id = 1; id <= frameCount; ++id ) {
+		synthesizeFrameSnapshot( id, id * period, handCount, &snapshot );
+		server->publish( fromFrameSnapshot( snapshot ) );
+		client->update();
+		this_thread::sleep_until( start + chrono::microseconds( id * period ) );
+	}
+	double elapsed = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+
+	// Let the last packets arrive
+	this_thread::sleep_for( chrono::milliseconds( 100 ) );
+	client->update();
+
+	printf( "%s, %u hands, batches of %u\n", tcp ? "TCP" : "UDP", 
+		(uint32_t)snapshot.mHandCount, (uint32_t)batchSize );
+	printf( "Sent      %lld frames, %.1f frames/s\n", (long long)frameCount, frameCount / elapsed );
+	printf( "Received  %llu frames, %llu dropped\n", 
+		(unsigned long long)client->getFramesReceived(), 
+		(unsigned long long)client->getFramesDropped() );
+	printf( "Delivered %lld frames, %lld out of order\n", 
+		(long long)receiver.mFrames, (long long)receiver.mOutOfOrder );
+	printf( "Bandwidth %.1f KB/s, %.1f bytes per frame\n", 
+		server->getBytesSent() / elapsed / 1000.0, 
+		frameCount > 0 ? (double)server->getBytesSent() / frameCount : 0.0 );
+	printf( "Latency   %.3f ms\n", client->getLatency() * 1000.0 );
+	return receiver.mFrames > 0 && receiver.mOutOfOrder == 0 ? 0 : 1;
+}